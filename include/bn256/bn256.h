@@ -31,6 +31,7 @@ namespace bn256 {
 struct curve_point;
 struct twist_point;
 struct gfp12;
+struct prepared_twist;
 
 // uint255_t should be a 255 bits integer in little endian format
 using uint255_t = std::array<uint64_t, 4>;
@@ -52,6 +53,17 @@ class g1 {
 
    g1 scalar_mult(const uint255_t& k) const noexcept;
 
+   // multi_scalar_mult returns Σ scalars[i]·points[i] with Pippenger's bucket
+   // method, which is much faster than separate scalar_mult calls once there
+   // are more than a few points. Elements of the longer span without a
+   // counterpart in the other are ignored. The work is spread over threads
+   // threads, at most std::thread::hardware_concurrency(); if threads cannot
+   // be started the work runs on the calling thread. Throws std::bad_alloc
+   // when the scratch space, a few hundred bytes per point, cannot be
+   // allocated.
+   static g1 multi_scalar_mult(std::span<const g1> points, std::span<const uint255_t> scalars,
+                               unsigned threads = 1);
+
    g1 add(const g1& b) const noexcept;
 
    g1 neg();
@@ -65,6 +77,32 @@ class g1 {
 
    [[nodiscard]] std::error_code unmarshal(std::span<const uint8_t, 64> in) noexcept;
 
+   // marshal_compressed converts g1 to its 32 byte compressed form: the x
+   // coordinate, big endian, whose two top bits (always clear as p < 2²⁵⁴) flag
+   // the sign of y (0x80, see gfp::sgn0) and the point at infinity (0x40).
+   void                    marshal_compressed(std::span<uint8_t, 32> out) const noexcept;
+   std::array<uint8_t, 32> marshal_compressed() const noexcept {
+      std::array<uint8_t, 32> result;
+      marshal_compressed(result);
+      return result;
+   }
+
+   // unmarshal_compressed sets g1 to the result of converting the output of
+   // marshal_compressed back into a group element, which costs a square root.
+   [[nodiscard]] std::error_code unmarshal_compressed(std::span<const uint8_t, 32> in) noexcept;
+
+   // batch_normalize converts points to affine form, sharing one field
+   // inversion between every 64 points. Marshaling a normalized point needs no
+   // further inversion. It does not allocate.
+   static void batch_normalize(std::span<g1> points) noexcept;
+
+   // batch_marshal marshals points into consecutive 64 byte chunks of out,
+   // sharing one field inversion between every 64 points, without allocating.
+   // out should hold 64 * points.size() bytes. Only the first
+   // out.size() / 64 points are marshaled when it is smaller; the rest are
+   // skipped without any error.
+   static void batch_marshal(std::span<const g1> points, std::span<uint8_t> out) noexcept;
+
    bool operator==(const g1& rhs) const noexcept { return std::memcmp(p_, rhs.p_, sizeof(*this)) == 0; }
    bool operator!=(const g1& rhs) const noexcept { return !(*this == rhs); }
 
@@ -104,6 +142,32 @@ class g2 {
 
    [[nodiscard]] std::error_code unmarshal(std::span<const uint8_t, 128> m) noexcept;
 
+   // marshal_compressed converts g2 to its 64 byte compressed form: the x
+   // coordinate as in marshal, with the sign of y (0x80, see gfp2::sgn0) and
+   // the point at infinity (0x40) flagged in the top bits of the first byte.
+   void                    marshal_compressed(std::span<uint8_t, 64> out) const noexcept;
+   std::array<uint8_t, 64> marshal_compressed() const noexcept {
+      std::array<uint8_t, 64> result;
+      marshal_compressed(result);
+      return result;
+   }
+
+   // unmarshal_compressed sets g2 to the result of converting the output of
+   // marshal_compressed back into a group element, which costs a square root
+   // in GF(p²) and a subgroup check.
+   [[nodiscard]] std::error_code unmarshal_compressed(std::span<const uint8_t, 64> m) noexcept;
+
+   // batch_normalize converts points to affine form, sharing one field
+   // inversion between every 64 points. It does not allocate.
+   static void batch_normalize(std::span<g2> points) noexcept;
+
+   // batch_marshal marshals points into consecutive 128 byte chunks of out,
+   // sharing one field inversion between every 64 points, without allocating.
+   // out should hold 128 * points.size() bytes. Only the first
+   // out.size() / 128 points are marshaled when it is smaller; the rest are
+   // skipped without any error.
+   static void batch_marshal(std::span<const g2> points, std::span<uint8_t> out) noexcept;
+
    bool operator==(const g2& rhs) const noexcept { return std::memcmp(p_, rhs.p_, sizeof(*this)) == 0; }
    bool operator!=(const g2& rhs) const noexcept { return !(*this == rhs); }
 
@@ -112,6 +176,24 @@ class g2 {
 
 inline std::ostream& operator<<(std::ostream& os, const g2& v) { return os << v.string(); }
 
+// g2_prepared caches the Miller loop line coefficients of a fixed g2 point.
+// Pairing against a g2_prepared skips all the G₂ arithmetic of the Miller
+// loop, which pays off when the same g2 point is paired repeatedly.
+class g2_prepared {
+   static constexpr std::size_t num_lines = 91;
+
+   uint64_t lines_[num_lines * 3 * 2 * 4];
+   bool     infinity_ = true;
+
+ public:
+   g2_prepared() = default;
+   explicit g2_prepared(const g2& q) noexcept;
+
+   const prepared_twist& p() const;
+
+   bool is_infinity() const noexcept { return infinity_; }
+};
+
 // GT is an abstract cyclic group. The zero value is suitable for use as the
 // output of an operation, but cannot be used as an input.
 class gt {
@@ -125,8 +207,15 @@ class gt {
    gfp12& p();
    const gfp12& p() const;
 
+   // scalar_mult returns a^k for any element, including miller outputs that
+   // have not been finalized and unmarshaled values.
    gt scalar_mult(const uint255_t& k) const noexcept;
 
+   // subgroup_scalar_mult returns a^k with the faster GLS method, which is only
+   // correct for elements of the target group, such as outputs of pair and
+   // finalize. The result is wrong for any other element.
+   gt subgroup_scalar_mult(const uint255_t& k) const noexcept;
+
    gt add(const gt& b) const noexcept;
 
    gt neg() const noexcept;
@@ -156,8 +245,18 @@ std::ostream& operator<<(std::ostream& os, const gt& v);
 // pair calculates an Optimal Ate pairing.
 gt pair(const g1& g1, const g2& g2) noexcept;
 
-// pairing_check calculates the Optimal Ate pairing for a set of points.
-bool pairing_check(std::span<const g1> a, std::span<const g2> b) noexcept;
+// pair calculates an Optimal Ate pairing against a prepared g2 point.
+gt pair(const g1& g1, const g2_prepared& g2) noexcept;
+
+// pairing_check calculates the Optimal Ate pairing for a set of points. It
+// allocates scratch space for every pair and throws std::bad_alloc if that
+// fails.
+bool pairing_check(std::span<const g1> a, std::span<const g2> b);
+
+// pairing_check calculates the Optimal Ate pairing for a set of points against
+// prepared g2 points. It allocates scratch space for every pair and throws
+// std::bad_alloc if that fails.
+bool pairing_check(std::span<const g1> a, std::span<const g2_prepared> b);
 
 /// pairing_check calculates the Optimal Ate pairing for a set of points.
 ///  @param marshaled_g1g2_pairs marshaled g1 g2 pair sequence
@@ -172,6 +271,12 @@ int32_t g1_add(std::span<const uint8_t, 64> marshaled_lhs, std::span<const uint8
 /// @return -1 for unmarshal error, 0 for success
 int32_t g1_scalar_mul(std::span<const uint8_t, 64> marshaled_g1, std::span<const uint8_t, 32> scalar, std::span<uint8_t, 64> result);
 
+/// multiply a sequence of marshaled g1 points, each followed by a 255 bits big endian integer, with their
+/// scalars and then marshal the sum of the products into result, see g1::multi_scalar_mult
+/// @return -1 for unmarshal error, 0 for success
+int32_t g1_multi_scalar_mul(std::span<const uint8_t> marshaled_g1_scalar_pairs, std::span<uint8_t, 64> result,
+                            unsigned threads = 1);
+
 // miller applies Miller's algorithm, which is a bilinear function from
 // the source groups to F_p^12. miller(g1, g2).finalize() is equivalent
 // to pair(g1,g2).
@@ -63,6 +63,14 @@ constexpr uint64_t mulx_u64(uint64_t a, uint64_t b, uint64_t* hi) noexcept {
    return static_cast<uint64_t>(x & 0xFFFFFFFFFFFFFFFFULL);
 }
 
+// mac_u64 returns the low word of a·b + c + d and sets hi to the high word. The
+// sum cannot overflow 128 bits.
+constexpr uint64_t mac_u64(uint64_t a, uint64_t b, uint64_t c, uint64_t d, uint64_t* hi) noexcept {
+   __uint128_t x = static_cast<__uint128_t>(a) * b + c + d;
+   *hi           = static_cast<uint64_t>(x >> 64);
+   return static_cast<uint64_t>(x);
+}
+
 constexpr bool subborrow_u256(bool carry, const uint64_t* a, const uint64_t* b, uint64_t* c) noexcept {
    carry = subborrow_u64(carry, a[0], b[0], &c[0]);
    carry = subborrow_u64(carry, a[1], b[1], &c[1]);
@@ -178,6 +186,53 @@ constexpr bool addcarry_u512(bool carry, const uint64_t* a, const uint64_t* b, u
    addcarry_u64(carry, 0, rsi, &c[7]);
 }
 
+// full_sqr_u256 sets c to the 512-bit square of a. The cross products a[i]·a[j]
+// with i < j appear twice in the square, so they are summed once and doubled
+// with a shift before the diagonal terms a[i]² are added: 10 multiplications
+// instead of 16.
+[[gnu::always_inline]] [[gnu::hot]] constexpr void full_sqr_u256(const uint64_t* a, uint64_t* c) noexcept {
+   uint64_t t1 = 0, t2 = 0, t3 = 0, t4 = 0, t5 = 0, t6 = 0, t7 = 0, lo = 0, hi = 0, u = 0;
+   bool     carry = false;
+   t1    = mulx_u64(a[0], a[1], &t2);
+   lo    = mulx_u64(a[0], a[2], &t3);
+   carry = addcarry_u64(false, t2, lo, &t2);
+   lo    = mulx_u64(a[0], a[3], &t4);
+   carry = addcarry_u64(carry, t3, lo, &t3);
+   addcarry_u64(carry, t4, 0, &t4);
+
+   lo    = mulx_u64(a[1], a[2], &hi);
+   u     = mulx_u64(a[1], a[3], &t5);
+   carry = addcarry_u64(false, t3, lo, &t3);
+   carry = addcarry_u64(carry, t4, hi, &t4);
+   addcarry_u64(carry, t5, 0, &t5);
+   carry = addcarry_u64(false, t4, u, &t4);
+   addcarry_u64(carry, t5, 0, &t5);
+
+   lo    = mulx_u64(a[2], a[3], &t6);
+   carry = addcarry_u64(false, t5, lo, &t5);
+   addcarry_u64(carry, t6, 0, &t6);
+
+   carry = addcarry_u64(false, t1, t1, &t1);
+   carry = addcarry_u64(carry, t2, t2, &t2);
+   carry = addcarry_u64(carry, t3, t3, &t3);
+   carry = addcarry_u64(carry, t4, t4, &t4);
+   carry = addcarry_u64(carry, t5, t5, &t5);
+   carry = addcarry_u64(carry, t6, t6, &t6);
+   t7    = carry;
+
+   c[0]  = mulx_u64(a[0], a[0], &hi);
+   carry = addcarry_u64(false, t1, hi, &c[1]);
+   lo    = mulx_u64(a[1], a[1], &hi);
+   carry = addcarry_u64(carry, t2, lo, &c[2]);
+   carry = addcarry_u64(carry, t3, hi, &c[3]);
+   lo    = mulx_u64(a[2], a[2], &hi);
+   carry = addcarry_u64(carry, t4, lo, &c[4]);
+   carry = addcarry_u64(carry, t5, hi, &c[5]);
+   lo    = mulx_u64(a[3], a[3], &hi);
+   carry = addcarry_u64(carry, t6, lo, &c[6]);
+   addcarry_u64(carry, t7, hi, &c[7]);
+}
+
 [[gnu::always_inline]] [[gnu::hot]]
 constexpr void half_mul_u256(const uint64_t* a, const uint64_t* b, uint64_t* c) noexcept {
 #ifdef BN256_HAS_EXTINT
@@ -1,6 +1,9 @@
 #include "curve.h"
+#include "fixed_base.h"
+#include "msm.h"
 #include "optate.h"
 #include "random_255.h"
+#include <algorithm>
 #include <bn256/bn256.h>
 #include <vector>
 
@@ -18,6 +21,64 @@ namespace {
          }
       }
    };
+
+   // canonicalize brings each coordinate of an element stored in words into
+   // [0, p), so that the public types can keep comparing their bytes when field
+   // elements are kept in a redundant representation (BN256_REDUNDANT).
+   template <std::size_t N>
+   void canonicalize([[maybe_unused]] uint64_t (&words)[N]) noexcept {
+#ifdef BN256_REDUNDANT
+      for (std::size_t i = 0; i < N; i += 4) {
+         gfp c = gfp{ words[i], words[i + 1], words[i + 2], words[i + 3] }.canonical();
+         std::copy(c.begin(), c.end(), &words[i]);
+      }
+#endif
+   }
+
+   // marshal_affine writes the coordinates of a point in affine form.
+   void marshal_affine(const curve_point& affined, std::span<uint8_t, 64> m) noexcept {
+      constexpr auto num_bytes = 256 / 8;
+      if (affined.is_infinity()) {
+         memset(m.data(), 0, m.size());
+         return;
+      }
+
+      affined.x_.mont_decode().marshal(m.subspan<0, num_bytes>());
+      affined.y_.mont_decode().marshal(m.subspan<num_bytes, num_bytes>());
+   }
+
+   void marshal_affine(const twist_point& affined, std::span<uint8_t, 128> view) noexcept {
+      constexpr auto num_bytes = 256 / 8;
+      if (affined.is_infinity()) {
+         memset(view.data(), 0, view.size());
+         return;
+      }
+
+      affined.x_.x_.mont_decode().marshal(view.subspan<0, num_bytes>());
+      affined.x_.y_.mont_decode().marshal(view.subspan<num_bytes, num_bytes>());
+      affined.y_.x_.mont_decode().marshal(view.subspan<num_bytes * 2, num_bytes>());
+      affined.y_.y_.mont_decode().marshal(view.subspan<num_bytes * 3, num_bytes>());
+   }
+
+   // foreach_affine_chunk calls fun(offset, affined) for consecutive chunks of
+   // the points of a g1 or g2 span, where affined holds the points at offset
+   // onwards in affine form, see batch_make_affine. One field inversion is
+   // shared per chunk, and the scratch space is a fixed-size stack buffer, so
+   // any number of points can be converted without allocating.
+   template <typename Point, typename G, typename Fun>
+   void foreach_affine_chunk(std::span<const G> points, Fun&& fun) noexcept {
+      using field                 = decltype(Point{}.z_);
+      constexpr std::size_t chunk = 64;
+
+      std::array<Point, chunk> affined;
+      std::array<field, chunk> z_inv, scratch;
+      for (std::size_t offset = 0; offset < points.size(); offset += chunk) {
+         const std::size_t n = std::min(chunk, points.size() - offset);
+         for (std::size_t i = 0; i < n; ++i) { affined[i] = points[offset + i].p(); }
+         batch_make_affine(std::span<Point>(affined.data(), n), z_inv, scratch);
+         fun(offset, std::span<const Point>(affined.data(), n));
+      }
+   }
 } // namespace
 
 inline std::error_code make_error_code(unmarshal_error e) noexcept {
@@ -33,6 +94,46 @@ struct is_error_code_enum<bn256::unmarshal_error> : true_type {};
 
 namespace bn256 {
 
+namespace {
+   // Flags stored in the top bits of the first byte of compressed points.
+   constexpr uint8_t compressed_sign_flag     = 0x80;
+   constexpr uint8_t compressed_infinity_flag = 0x40;
+   constexpr uint8_t compressed_flags         = compressed_sign_flag | compressed_infinity_flag;
+
+   // unmarshal_compressed_flags copies the coordinate bytes of a compressed
+   // point into out with the flags cleared and stores the flags in flags.
+   // Infinity must come without the sign flag and with all other bits clear.
+   template <std::size_t N>
+   std::error_code unmarshal_compressed_flags(std::span<const uint8_t, N> m, std::array<uint8_t, N>& out,
+                                              uint8_t& flags) noexcept {
+      std::copy(m.begin(), m.end(), out.begin());
+      flags = out[0] & compressed_flags;
+      out[0] &= ~compressed_flags;
+
+      if ((flags & compressed_infinity_flag) != 0 &&
+          (flags != compressed_infinity_flag || std::any_of(out.begin(), out.end(), [](uint8_t b) { return b != 0; }))) {
+         return unmarshal_error::MALFORMED_POINT;
+      }
+      return {};
+   }
+} // namespace
+
+namespace {
+   // The fixed-base tables for the generators are built on first use, which
+   // takes a few milliseconds. The constructor is constexpr, but building the
+   // tables at compile time exceeds the default constexpr evaluation limits of
+   // GCC and clang.
+   const fixed_base_table<curve_point, 5>& curve_gen_table() noexcept {
+      static const fixed_base_table<curve_point, 5> table{ curve_gen };
+      return table;
+   }
+
+   const fixed_base_table<twist_point, 5>& twist_gen_table() noexcept {
+      static const fixed_base_table<twist_point, 5> table{ twist_gen };
+      return table;
+   }
+} // namespace
+
 std::tuple<uint255_t, g1> ramdom_g1() {
    auto k = random_255();
    return std::tuple(k, g1::scalar_base_mult(k));
@@ -41,6 +142,7 @@ std::tuple<uint255_t, g1> ramdom_g1() {
 g1::g1(const curve_point& p) {
    static_assert(sizeof(*this) == sizeof(curve_point));
    memcpy(this, &p, sizeof(*this));
+   canonicalize(p_);
 }
 
 g1 g1::curve_gen{ bn256::curve_gen };
@@ -58,11 +160,18 @@ const curve_point& g1::p() const {
 std::string g1::string() const { return p().string(); }
 
 // scalar_base_mult returns g*k where g is the generator of the group
-g1 g1::scalar_base_mult(const uint255_t& k) noexcept { return g1{ bn256::curve_gen.mul(k) }; }
+g1 g1::scalar_base_mult(const uint255_t& k) noexcept { return g1{ curve_gen_table().mul(k) }; }
 
 // scalar_mult returns a*k
 g1 g1::scalar_mult(const uint255_t& k) const noexcept { return g1{ p().mul(k) }; }
 
+g1 g1::multi_scalar_mult(std::span<const g1> points, std::span<const uint255_t> scalars, unsigned threads) {
+   static_assert(sizeof(g1) == sizeof(curve_point));
+   const std::span<const curve_point> ps{ reinterpret_cast<const curve_point*>(points.data()), points.size() };
+   threads = std::min(threads, std::max(std::thread::hardware_concurrency(), 1u));
+   return g1{ bn256::multi_scalar_mult<curve_point>(ps, scalars, threads) };
+}
+
 // add sets g1 to a+b and then returns g1.
 g1 g1::add(const g1& b) const noexcept { return g1{ p().add(b.p()) }; }
 
@@ -70,17 +179,23 @@ g1 g1::add(const g1& b) const noexcept { return g1{ p().add(b.p()) }; }
 g1 g1::neg() { return g1{ p().neg() }; }
 
 // marshal converts g1 to a byte slice.
-void g1::marshal(std::span<uint8_t, 64> m) const noexcept {
-   constexpr auto num_bytes = 256 / 8;
-   auto           affined   = p().make_affine();
-   if (affined.is_infinity()) {
-      memset(m.data(), 0, m.size());
-      return;
-   }
+void g1::marshal(std::span<uint8_t, 64> m) const noexcept { marshal_affine(p().make_affine(), m); }
 
-   affined.x_.mont_decode().marshal(m.subspan<0, num_bytes>());
-   affined.y_.mont_decode().marshal(m.subspan<num_bytes, num_bytes>());
-   return;
+void g1::batch_normalize(std::span<g1> points) noexcept {
+   foreach_affine_chunk<curve_point>(std::span<const g1>(points), [points](std::size_t offset, auto affined) {
+      for (std::size_t i = 0; i < affined.size(); ++i) { points[offset + i] = g1{ affined[i] }; }
+   });
+}
+
+void g1::batch_marshal(std::span<const g1> points, std::span<uint8_t> out) noexcept {
+   constexpr std::size_t size = 64;
+   points                     = points.first(std::min(points.size(), out.size() / size));
+
+   foreach_affine_chunk<curve_point>(points, [out](std::size_t offset, auto affined) {
+      for (std::size_t i = 0; i < affined.size(); ++i) {
+         marshal_affine(affined[i], std::span<uint8_t, size>{ out.data() + (offset + i) * size, size });
+      }
+   });
 }
 
 // unmarshal sets g1 to the result of converting the output of marshal back into
@@ -111,6 +226,49 @@ std::error_code g1::unmarshal(std::span<const uint8_t, 64> m) noexcept {
    return {};
 }
 
+void g1::marshal_compressed(std::span<uint8_t, 32> m) const noexcept {
+   auto affined = p().make_affine();
+   if (affined.is_infinity()) {
+      memset(m.data(), 0, m.size());
+      m[0] = compressed_infinity_flag;
+      return;
+   }
+
+   affined.x_.mont_decode().marshal(m);
+   if (affined.y_.sgn0()) {
+      m[0] |= compressed_sign_flag;
+   }
+}
+
+std::error_code g1::unmarshal_compressed(std::span<const uint8_t, 32> m) noexcept {
+   std::array<uint8_t, 32> buf;
+   uint8_t                 flags = 0;
+   if (auto ec = unmarshal_compressed_flags(m, buf, flags); ec)
+      return ec;
+
+   if (flags & compressed_infinity_flag) {
+      *this = g1{ curve_point::infinity() };
+      return {};
+   }
+
+   gfp x;
+   if (auto ec = x.unmarshal(buf); ec != unmarshal_error::NO_ERROR)
+      return ec;
+   x = x.mont_encode();
+
+   gfp y2 = x.square().mul(x).add(curve_point::curve_b);
+   gfp y  = y2.sqrt();
+   if (y.square() != y2) {
+      return unmarshal_error::MALFORMED_POINT;
+   }
+   if (y.sgn0() != ((flags & compressed_sign_flag) != 0)) {
+      y = y.neg();
+   }
+
+   *this = g1{ curve_point{ x, y, new_gfp(1), new_gfp(1) } };
+   return {};
+}
+
 std::tuple<uint255_t, g2> ramdom_g2() {
    auto k = random_255();
    return std::make_tuple(k, g2::scalar_base_mult(k));
@@ -119,6 +277,7 @@ std::tuple<uint255_t, g2> ramdom_g2() {
 g2::g2(const twist_point& p) {
    static_assert(sizeof(*this) == sizeof(twist_point));
    memcpy(this, &p, sizeof(*this));
+   canonicalize(p_);
 }
 
 g2 g2::twist_gen{ bn256::twist_gen };
@@ -137,10 +296,10 @@ std::string g2::string() const { return p().string(); }
 
 // scalar_base_mult sets g2 to g*k where g is the generator of the group and then
 // returns out.
-g2 g2::scalar_base_mult(const uint255_t& k) noexcept { return g2{ bn256::twist_gen.mul(k) }; }
+g2 g2::scalar_base_mult(const uint255_t& k) noexcept { return g2{ twist_gen_table().mul(k) }; }
 
 // scalar_mult sets g2 to a*k and then returns g2.
-g2 g2::scalar_mult(const uint255_t& k) const noexcept { return g2{ p().mul(k) }; }
+g2 g2::scalar_mult(const uint255_t& k) const noexcept { return g2{ p().gls_mul(k) }; }
 
 // add sets g2 to a+b and then returns g2.
 g2 g2::add(const g2& b) const noexcept { return g2{ p().add(b.p()) }; }
@@ -149,18 +308,23 @@ g2 g2::add(const g2& b) const noexcept { return g2{ p().add(b.p()) }; }
 g2 g2::neg() const noexcept { return g2{ p().neg() }; }
 
 // marshal converts g2 to a byte slice.
-void g2::marshal(std::span<uint8_t, 128> view) const noexcept {
-   constexpr auto num_bytes = 256 / 8;
-   auto           affined   = p().make_affine();
-   if (affined.is_infinity()) {
-      memset(view.data(), 0, view.size());
-      return;
-   }
+void g2::marshal(std::span<uint8_t, 128> view) const noexcept { marshal_affine(p().make_affine(), view); }
+
+void g2::batch_normalize(std::span<g2> points) noexcept {
+   foreach_affine_chunk<twist_point>(std::span<const g2>(points), [points](std::size_t offset, auto affined) {
+      for (std::size_t i = 0; i < affined.size(); ++i) { points[offset + i] = g2{ affined[i] }; }
+   });
+}
+
+void g2::batch_marshal(std::span<const g2> points, std::span<uint8_t> out) noexcept {
+   constexpr std::size_t size = 128;
+   points                     = points.first(std::min(points.size(), out.size() / size));
 
-   affined.x_.x_.mont_decode().marshal(view.subspan<0, num_bytes>());
-   affined.x_.y_.mont_decode().marshal(view.subspan<num_bytes, num_bytes>());
-   affined.y_.x_.mont_decode().marshal(view.subspan<num_bytes * 2, num_bytes>());
-   affined.y_.y_.mont_decode().marshal(view.subspan<num_bytes * 3, num_bytes>());
+   foreach_affine_chunk<twist_point>(points, [out](std::size_t offset, auto affined) {
+      for (std::size_t i = 0; i < affined.size(); ++i) {
+         marshal_affine(affined[i], std::span<uint8_t, size>{ out.data() + (offset + i) * size, size });
+      }
+   });
 }
 
 // unmarshal sets g2 to the result of converting the output of marshal back into
@@ -201,11 +365,81 @@ std::error_code g2::unmarshal(std::span<const uint8_t, 128> m) noexcept {
    return {};
 }
 
+void g2::marshal_compressed(std::span<uint8_t, 64> m) const noexcept {
+   constexpr auto num_bytes = 256 / 8;
+   auto           affined   = p().make_affine();
+   if (affined.is_infinity()) {
+      memset(m.data(), 0, m.size());
+      m[0] = compressed_infinity_flag;
+      return;
+   }
+
+   affined.x_.x_.mont_decode().marshal(m.subspan<0, num_bytes>());
+   affined.x_.y_.mont_decode().marshal(m.subspan<num_bytes, num_bytes>());
+   if (affined.y_.sgn0()) {
+      m[0] |= compressed_sign_flag;
+   }
+}
+
+std::error_code g2::unmarshal_compressed(std::span<const uint8_t, 64> m) noexcept {
+   constexpr auto          num_bytes = 256 / 8;
+   std::array<uint8_t, 64> buf;
+   uint8_t                 flags = 0;
+   if (auto ec = unmarshal_compressed_flags(m, buf, flags); ec)
+      return ec;
+
+   if (flags & compressed_infinity_flag) {
+      *this = g2{ twist_point::infinity() };
+      return {};
+   }
+
+   gfp2 x;
+   if (auto ec = x.x_.unmarshal(std::span(buf).subspan<0, num_bytes>()); ec != unmarshal_error::NO_ERROR)
+      return ec;
+
+   if (auto ec = x.y_.unmarshal(std::span(buf).subspan<num_bytes, num_bytes>()); ec != unmarshal_error::NO_ERROR)
+      return ec;
+
+   x.x_ = x.x_.mont_encode();
+   x.y_ = x.y_.mont_encode();
+
+   gfp2 y2 = x.square().mul(x).add(twist_point::twist_b);
+   gfp2 y  = y2.sqrt();
+   if (y.square() != y2) {
+      return unmarshal_error::MALFORMED_POINT;
+   }
+   if (y.sgn0() != ((flags & compressed_sign_flag) != 0)) {
+      y = y.neg();
+   }
+
+   twist_point q{ x, y, gfp2::one(), gfp2::one() };
+   if (!q.is_in_subgroup()) {
+      return unmarshal_error::MALFORMED_POINT;
+   }
+
+   *this = g2{ q };
+   return {};
+}
+
+g2_prepared::g2_prepared(const g2& q) noexcept : infinity_(q.p().is_infinity()) {
+   static_assert(sizeof(lines_) == sizeof(prepared_twist));
+   if (!infinity_) {
+      auto prepared = prepare_twist(q.p());
+      memcpy(lines_, &prepared, sizeof(lines_));
+   }
+}
+
+const prepared_twist& g2_prepared::p() const {
+   static_assert(sizeof(lines_) == sizeof(prepared_twist));
+   return *reinterpret_cast<const prepared_twist*>(lines_);
+}
+
 std::string gt::string() const { return p().string(); }
 
 gt::gt(const gfp12& p) {
    static_assert(sizeof(*this) == sizeof(gfp12));
    memcpy(this, &p, sizeof(*this));
+   canonicalize(p_);
 }
 
 gfp12& gt::p() {
@@ -221,6 +455,8 @@ const gfp12& gt::p() const {
 // scalar_mult return a*k
 gt gt::scalar_mult(const uint255_t& k) const noexcept { return gt{ p().exp(k) }; }
 
+gt gt::subgroup_scalar_mult(const uint255_t& k) const noexcept { return gt{ p().gls_exp(k) }; }
+
 // add sets gt to a*b and then returns gt.
 gt gt::add(const gt& b) const noexcept { return gt{ p().mul(b.p()) }; }
 
@@ -304,17 +540,45 @@ std::error_code gt::unmarshal(std::span<const uint8_t, 384> m) noexcept {
 // pair calculates an Optimal Ate pairing.
 gt pair(const g1& g1, const g2& g2) noexcept { return gt{ optimal_ate(g2.p(), g1.p()) }; }
 
+// pair calculates an Optimal Ate pairing against a prepared g2 point.
+gt pair(const g1& g1, const g2_prepared& g2) noexcept {
+   if (g1.p().is_infinity() || g2.is_infinity()) {
+      return gt{ gfp12::one() };
+   }
+   return gt{ final_exponentiation(miller(g2.p(), g1.p())) };
+}
+
 // pairing_check calculates the Optimal Ate pairing for a set of points.
-bool pairing_check(std::span<const g1> a, std::span<const g2> b) noexcept {
-   gfp12 acc{};
-   acc.set_one();
+bool pairing_check(std::span<const g1> a, std::span<const g2> b) {
+   std::vector<twist_point> qs;
+   std::vector<curve_point> ps;
+   qs.reserve(a.size());
+   ps.reserve(a.size());
    for (auto i = 0U; i < a.size(); ++i) {
       if (a[i].p().is_infinity() || b[i].p().is_infinity()) {
          continue;
       }
-      acc = acc.mul(miller(b[i].p(), a[i].p()));
+      qs.push_back(b[i].p());
+      ps.push_back(a[i].p());
    }
-   return final_exponentiation(acc).is_one();
+   return fast_final_exponentiation(multi_miller(qs, ps)).is_one();
+}
+
+// pairing_check calculates the Optimal Ate pairing for a set of points against
+// prepared g2 points.
+bool pairing_check(std::span<const g1> a, std::span<const g2_prepared> b) {
+   std::vector<const prepared_twist*> qs;
+   std::vector<curve_point>           ps;
+   qs.reserve(a.size());
+   ps.reserve(a.size());
+   for (auto i = 0U; i < a.size(); ++i) {
+      if (a[i].p().is_infinity() || b[i].is_infinity()) {
+         continue;
+      }
+      qs.push_back(&b[i].p());
+      ps.push_back(a[i].p());
+   }
+   return fast_final_exponentiation(multi_miller(qs, ps)).is_one();
 }
 
 int32_t pairing_check(std::span<const uint8_t> marshaled_g1g2_pair, std::function<void()> yield) {
@@ -325,8 +589,10 @@ int32_t pairing_check(std::span<const uint8_t> marshaled_g1g2_pair, std::functio
    const uint8_t* data     = marshaled_g1g2_pair.data();
    const uint8_t* data_end = marshaled_g1g2_pair.data() + marshaled_g1g2_pair.size();
 
-   gfp12 acc{};
-   acc.set_one();
+   std::vector<twist_point> qs;
+   std::vector<curve_point> ps;
+   qs.reserve(marshaled_g1g2_pair.size() / marshaled_g1g2_pair_size);
+   ps.reserve(marshaled_g1g2_pair.size() / marshaled_g1g2_pair_size);
    while (data < data_end) {
       g1 a;
       if (auto err = a.unmarshal(std::span<const uint8_t, 64>{ data, 64 }); err)
@@ -339,11 +605,14 @@ int32_t pairing_check(std::span<const uint8_t> marshaled_g1g2_pair, std::functio
       if (a.p().is_infinity() || b.p().is_infinity()) {
          continue;
       }
-      acc = acc.mul(miller(b.p(), a.p()));
-      yield();
+      qs.push_back(b.p());
+      ps.push_back(a.p());
    }
 
-   return final_exponentiation(acc).is_one();
+   // The Miller loop yields after every preparation and iteration.
+   const gfp12 f = multi_miller(std::span<const twist_point>(qs), ps, yield);
+   yield();
+   return fast_final_exponentiation(f).is_one();
 }
 
 int32_t g1_add(std::span<const uint8_t, 64> marshaled_lhs, std::span<const uint8_t, 64> marshaled_rhs,
@@ -371,6 +640,29 @@ int32_t g1_scalar_mul(std::span<const uint8_t, 64> marshaled_g1, std::span<const
    return 0;
 }
 
+int32_t g1_multi_scalar_mul(std::span<const uint8_t> marshaled_g1_scalar_pairs, std::span<uint8_t, 64> result,
+                            unsigned threads) {
+   const int marshaled_g1_scalar_pair_size = 64 + 32;
+   if (marshaled_g1_scalar_pairs.size() % marshaled_g1_scalar_pair_size != 0)
+      return -1;
+
+   const std::size_t n    = marshaled_g1_scalar_pairs.size() / marshaled_g1_scalar_pair_size;
+   const uint8_t*    data = marshaled_g1_scalar_pairs.data();
+
+   std::vector<g1>        points(n);
+   std::vector<uint255_t> scalars(n);
+   for (std::size_t i = 0; i < n; ++i) {
+      if (auto err = points[i].unmarshal(std::span<const uint8_t, 64>{ data, 64 }); err)
+         return -1;
+      data += 64;
+      std::copy(std::reverse_iterator(data + 32), std::reverse_iterator(data), (uint8_t*)scalars[i].data());
+      data += 32;
+   }
+
+   g1::multi_scalar_mult(points, scalars, threads).marshal(result);
+   return 0;
+}
+
 // miller applies Miller's algorithm, which is a bilinear function from
 // the source groups to F_p^12. miller(g1, g2).finalize() is equivalent
 // to pair(g1,g2).
@@ -5,9 +5,21 @@
 
 namespace bn256 {
 
+// curve_affine is a finite point of the curve in affine coordinates. Tables of
+// precomputed points are normalized to this form so that they can be added
+// with curve_point::add_mixed.
+struct curve_affine {
+   gfp x_;
+   gfp y_;
+
+   constexpr curve_affine neg() const noexcept { return { x_, y_.neg() }; }
+};
+
 // curvePoint implements the elliptic curve y²=x³+3. Points are kept in Jacobian
 // form and t=z² when valid. G₁ is the set of points of this curve on GF(p).
 struct curve_point {
+   using affine = curve_affine;
+
    // value is xτ² + yτ + z
    gfp x_;
    gfp y_;
@@ -23,6 +35,8 @@ struct curve_point {
 
    static constexpr gfp curve_b = new_gfp(3);
 
+   static constexpr curve_point from_affine(const curve_affine& a) { return { a.x_, a.y_, new_gfp(1), new_gfp(1) }; }
+
 #if defined (__clang__)
 #pragma clang diagnostic pop
 #endif
@@ -49,8 +63,8 @@ struct curve_point {
       if (c.is_infinity()) {
          return true;
       }
-      gfp y2 = c.y_.mul(c.y_);
-      gfp x3 = c.x_.mul(c.x_);
+      gfp y2 = c.y_.square();
+      gfp x3 = c.x_.square();
       x3     = x3.mul(c.x_);
       x3     = x3.add(curve_b);
       return y2 == x3;
@@ -71,8 +85,8 @@ struct curve_point {
       // Normalize the points by replacing a = [x1:y1:z1] and b = [x2:y2:z2]
       // by [u1:s1:z1·z2] and [u2:s2:z1·z2]
       // where u1 = x1·z2², s1 = y1·z2³ and u1 = x2·z1², s2 = y2·z1³
-      gfp z12 = a.z_.mul(a.z_);
-      gfp z22 = b.z_.mul(b.z_);
+      gfp z12 = a.z_.square();
+      gfp z22 = b.z_.square();
 
       gfp u1 = a.x_.mul(z22);
       gfp u2 = b.x_.mul(z12);
@@ -96,7 +110,7 @@ struct curve_point {
 
       t = h.add(h);
       // i = 4h²
-      gfp i = t.mul(t);
+      gfp i = t.square();
       // j = 4h³
       gfp j = h.mul(i);
 
@@ -110,7 +124,7 @@ struct curve_point {
       gfp v = u1.mul(i);
 
       // t4 = 4(s2-s1)²
-      gfp t4 = r.mul(r);
+      gfp t4 = r.square();
       t      = v.add(v);
       gfp t6 = t4.sub(j);
 
@@ -129,7 +143,7 @@ struct curve_point {
 
       // Set z_ = 2(u2-u1)·z1·z2 = 2h·z1·z2
       t    = a.z_.add(b.z_); // t11
-      t4   = t.mul(t);       // t12
+      t4   = t.square();       // t12
       t    = t4.sub(z12);    // t13
       t4   = t.sub(z22);     // t14
       c.z_ = t4.mul(h);
@@ -137,24 +151,82 @@ struct curve_point {
       return c;
    }
 
+   // add_mixed returns a+b for an affine b, i.e. add with z2=1, which saves the
+   // computation of z2², z2³ and of u1 and s1.
+   constexpr curve_point add_mixed(const curve_affine& b) const noexcept {
+      const curve_point& a = *this;
+
+      if (a.is_infinity()) {
+         return from_affine(b);
+      }
+
+      // See http://hyperelliptic.org/EFD/g1p/auto-code/shortw/jacobian-0/addition/madd-2007-bl.op3
+      gfp z12 = a.z_.square();
+      gfp u2  = b.x_.mul(z12);
+      gfp t   = a.z_.mul(z12);
+      gfp s2  = b.y_.mul(t);
+
+      gfp  h       = u2.sub(a.x_);
+      bool x_equal = h == gfp{};
+
+      gfp hh = h.square();
+      // i = 4h²
+      gfp i = hh.add(hh);
+      i     = i.add(i);
+      // j = 4h³
+      gfp j = h.mul(i);
+
+      t            = s2.sub(a.y_);
+      bool y_equal = t == gfp{};
+      if (x_equal && y_equal) {
+         return a.double_();
+      }
+      gfp r = t.add(t);
+
+      gfp v = a.x_.mul(i);
+
+      curve_point c = {};
+
+      // x_ = r² - j - 2v
+      gfp t4 = r.square();
+      t      = v.add(v);
+      gfp t6 = t4.sub(j);
+      c.x_   = t6.sub(t);
+
+      // y_ = r(v-x_) - 2·y1·j
+      t    = v.sub(c.x_);
+      t4   = a.y_.mul(j);
+      t6   = t4.add(t4);
+      t4   = r.mul(t);
+      c.y_ = t4.sub(t6);
+
+      // z_ = (z1+h)² - z1² - h² = 2h·z1
+      t    = a.z_.add(h);
+      t4   = t.square();
+      t    = t4.sub(z12);
+      c.z_ = t.sub(hh);
+      c.t_ = {};
+      return c;
+   }
+
    constexpr curve_point double_() const noexcept {
       const curve_point& a = *this;
 
       // See http://hyperelliptic.org/EFD/g1p/auto-code/shortw/jacobian-0/doubling/dbl-2009-l.op3
 
-      gfp A = a.x_.mul(a.x_);
-      gfp B = a.y_.mul(a.y_);
-      gfp C = B.mul(B);
+      gfp A = a.x_.square();
+      gfp B = a.y_.square();
+      gfp C = B.square();
 
       gfp t  = a.x_.add(B);
-      gfp t2 = t.mul(t);
+      gfp t2 = t.square();
       t      = t2.sub(A);
       t2     = t.sub(C);
 
       gfp d = t2.add(t2);
       t     = A.add(A);
       gfp e = t.add(A);
-      gfp f = e.mul(e);
+      gfp f = e.square();
 
       t = d.add(d);
       curve_point c{};
@@ -173,31 +245,52 @@ struct curve_point {
       return c;
    }
 
-   curve_point mul(std::span<const uint64_t, 4> scalar) const noexcept {
-      const curve_point& a = *this;
+   // wnaf_mul computes scalar·a with the GLV method. curve_lattice splits scalar into
+   // k₀ + k₁·λ with sub-scalars of about 128 bits, where φ(x, y) = (βx, y) acts
+   // on G₁ as multiplication by λ. Both sub-scalars are recoded in width-W NAF,
+   // so every W+1 doublings need about two additions of precomputed odd
+   // multiples of a or φ(a), which are normalized with a single inversion.
+   template <int W>
+   curve_point wnaf_mul(std::span<const uint64_t, 4> scalar) const noexcept {
+      constexpr std::size_t table_size = 1 << (W - 2);
+      const curve_point&    a          = *this;
+      if (a.is_infinity()) {
+         return a;
+      }
 
-      std::array<curve_point, 4> precomp{};
+      // table[0][i] is (2i+1)·a and table[1][i] is φ((2i+1)·a).
+      std::array<curve_point, table_size> odd{};
+      const curve_point                   a2 = a.double_();
+      odd[0]                                 = a;
+      for (std::size_t i = 1; i < table_size; ++i) { odd[i] = odd[i - 1].add(a2); }
 
-      precomp[1]    = a;
-      precomp[2]    = a;
-      precomp[2].x_ = precomp[2].x_.mul(constants::xi_to_2p_squared_minus_2_over_3);
-      precomp[3]    = precomp[1].add(precomp[2]);
+      std::array<gfp, table_size> z_inv{}, scratch{};
+      for (std::size_t i = 0; i < table_size; ++i) { z_inv[i] = odd[i].z_; }
+      batch_invert(z_inv, scratch);
 
-      auto        sum = infinity();
-      curve_point t{};
+      std::array<std::array<curve_affine, table_size>, 2> table{};
+      for (std::size_t i = 0; i < table_size; ++i) {
+         table[0][i] = odd[i].to_affine(z_inv[i]);
+         table[1][i] = { table[0][i].x_.mul(constants::xi_to_2p_squared_minus_2_over_3), table[0][i].y_ };
+      }
 
-      curve_lattice.foreach_multi_scalar(scalar, [&sum, &t, &precomp] (uint8_t v){
-         t = sum.double_();
-         if (v == 0) {
-            sum = t;
-         } else {
-            sum = t.add(precomp[v]);
+      auto sum = infinity();
+      curve_lattice.foreach_wnaf_multi_scalar<W>(scalar, [&sum, &table](const std::array<int8_t, 2>& digits) {
+         sum = sum.double_();
+         for (std::size_t j = 0; j < digits.size(); ++j) {
+            if (digits[j] > 0) {
+               sum = sum.add_mixed(table[j][digits[j] / 2]);
+            } else if (digits[j] < 0) {
+               sum = sum.add_mixed(table[j][-digits[j] / 2].neg());
+            }
          }
       });
 
       return sum;
    }
 
+   curve_point mul(std::span<const uint64_t, 4> scalar) const noexcept { return wnaf_mul<5>(scalar); }
+
    constexpr curve_point make_affine() const noexcept {
       if (z_ == new_gfp(1)) {
          return *this;
@@ -205,16 +298,16 @@ struct curve_point {
          return { {}, new_gfp(1), new_gfp(0), {} };
       }
 
-      curve_point c{ x_, y_, new_gfp(1), new_gfp(1) };
-
-      gfp z_inv = z_.invert();
+      return make_affine(z_.invert());
+   }
 
-      gfp t      = c.y_.mul(z_inv);
-      gfp z_inv2 = z_inv.mul(z_inv);
-      c.x_       = c.x_.mul(z_inv2);
-      c.y_       = t.mul(z_inv2);
+   // make_affine returns the affine form of a finite point given z_inv=z⁻¹.
+   constexpr curve_point make_affine(const gfp& z_inv) const noexcept { return from_affine(to_affine(z_inv)); }
 
-      return c;
+   // to_affine returns the affine coordinates of a finite point given z_inv=z⁻¹.
+   constexpr curve_affine to_affine(const gfp& z_inv) const noexcept {
+      gfp z_inv2 = z_inv.square();
+      return { x_.mul(z_inv2), y_.mul(z_inv).mul(z_inv2) };
    }
 
    constexpr curve_point neg() const noexcept {
@@ -229,6 +322,32 @@ struct curve_point {
    constexpr bool operator!=(const curve_point& rhs) const noexcept { return !(*this == rhs); }
 };
 
+// batch_make_affine replaces every point by make_affine() of it, sharing a
+// single field inversion between all of them, see batch_invert. z_inv and
+// scratch must have room for points.size() elements.
+inline void batch_make_affine(std::span<curve_point> points, std::span<gfp> z_inv, std::span<gfp> scratch) noexcept {
+   z_inv   = z_inv.first(points.size());
+   scratch = scratch.first(points.size());
+   for (std::size_t i = 0; i < points.size(); ++i) { z_inv[i] = points[i].z_; }
+   batch_invert(z_inv, scratch);
+
+   for (std::size_t i = 0; i < points.size(); ++i) {
+      curve_point& p = points[i];
+      if (p.z_ == new_gfp(1)) {
+         continue;
+      } else if (p.is_infinity()) {
+         p = { {}, new_gfp(1), new_gfp(0), {} };
+      } else {
+         p = p.make_affine(z_inv[i]);
+      }
+   }
+}
+
+inline void batch_make_affine(std::span<curve_point> points) {
+   std::vector<gfp> z_inv(points.size()), scratch(points.size());
+   batch_make_affine(points, z_inv, scratch);
+}
+
 inline constexpr curve_point curve_gen = { new_gfp(1), new_gfp(2), new_gfp(1), new_gfp(1) };
 
 inline std::ostream& operator<<(std::ostream& os, const curve_point& v) { return os << v.string(); }
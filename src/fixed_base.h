@@ -0,0 +1,82 @@
+#pragma once
+#include "gfp2.h"
+#include <array>
+#include <span>
+
+namespace bn256 {
+
+// fixed_base_table holds multiples of a fixed point for scalar multiplication
+// without doublings. The scalar is recoded into signed digits of window bits,
+// k = Σ dᵢ·2^(window·i) with |dᵢ| ≤ 2^(window-1), and row i of the table holds
+// j·2^(window·i)·base for j = 1..2^(window-1) in affine form, so the product is
+// the sum of one table entry, or its negation, per non-zero digit, each added
+// with a mixed Jacobian-affine addition.
+//
+// All entries are computed by the constructor. It is constexpr, but building a
+// full table for a 256-bit scalar exceeds the constexpr evaluation limits of
+// GCC and clang, so the generator tables are function-local statics built on
+// first use instead.
+template <typename Point, std::size_t window>
+struct fixed_base_table {
+   static_assert(window >= 2 && window < 8);
+
+   static constexpr std::size_t entries = std::size_t(1) << (window - 1);
+   // A 256-bit scalar needs one more bit for the carry of the top digit.
+   static constexpr std::size_t rows = (256 + window) / window;
+
+   using affine = typename Point::affine;
+
+   std::array<std::array<affine, entries>, rows> table{};
+
+   constexpr explicit fixed_base_table(const Point& base) noexcept {
+      Point row_base = base;
+      for (auto& row : table) {
+         std::array<Point, entries> points{};
+         points[0] = row_base;
+         for (std::size_t j = 1; j < entries; ++j) { points[j] = points[j - 1].add(row_base); }
+         row_base = points[entries - 1].double_();
+
+         // Normalize the row with a single inversion.
+         std::array<decltype(base.z_), entries> z_inv{}, scratch{};
+         for (std::size_t j = 0; j < entries; ++j) { z_inv[j] = points[j].z_; }
+         batch_invert(z_inv, scratch);
+         for (std::size_t j = 0; j < entries; ++j) { row[j] = points[j].to_affine(z_inv[j]); }
+      }
+   }
+
+   // mul returns scalar·base.
+   constexpr Point mul(std::span<const uint64_t, 4> scalar) const noexcept {
+      constexpr uint64_t mask = (uint64_t(1) << window) - 1;
+
+      Point    sum   = Point::infinity();
+      uint64_t carry = 0;
+      for (std::size_t i = 0; i < rows; ++i) {
+         const std::size_t bit   = window * i;
+         const std::size_t word  = bit / 64;
+         const std::size_t shift = bit % 64;
+
+         uint64_t digit = 0;
+         if (word < 4) {
+            digit = scalar[word] >> shift;
+            if (shift + window > 64 && word + 1 < 4) {
+               digit |= scalar[word + 1] << (64 - shift);
+            }
+         }
+         digit = (digit & mask) + carry;
+
+         // Digits above 2^(window-1) are replaced by digit - 2^window.
+         carry = digit > entries;
+         if (carry) {
+            digit = mask + 1 - digit;
+            if (digit != 0) {
+               sum = sum.add_mixed(table[i][digit - 1].neg());
+            }
+         } else if (digit != 0) {
+            sum = sum.add_mixed(table[i][digit - 1]);
+         }
+      }
+      return sum;
+   }
+};
+
+} // namespace bn256
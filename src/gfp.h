@@ -1,9 +1,11 @@
 #pragma once
 #include "gfp_generic.h"
+#include "gfp_invert.h"
 #include <iosfwd>
 #include <string>
 #include <system_error>
 #include <span>
+#include <vector>
 
 namespace bn256 {
 
@@ -23,6 +25,36 @@ namespace constants {
                                                    0x20fd6e902d592544 };
 } // namespace constants
 
+struct gfp;
+
+// gfp_unreduced is a 512-bit product of field elements in Montgomery form whose
+// reduction has been postponed, so that sums and differences of products only
+// need a single montgomery_reduce. Its value is kept below p·2²⁵⁶.
+struct gfp_unreduced : std::array<uint64_t, 8> {
+   // add_unreduced adds without any correction. Because p < 2²⁵⁴, a sum of up to
+   // five products of elements below p is still below p·2²⁵⁶ (a single product
+   // with BN256_REDUNDANT, where the factors can be up to 2p).
+   constexpr gfp_unreduced add_unreduced(const gfp_unreduced& other) const noexcept {
+      gfp_unreduced c{};
+      addcarry_u512(false, data(), other.data(), c.data());
+      return c;
+   }
+
+   // sub_unreduced subtracts without any correction, for differences that are
+   // known not to be negative.
+   constexpr gfp_unreduced sub_unreduced(const gfp_unreduced& other) const noexcept {
+      gfp_unreduced c{};
+      subborrow_u512(false, data(), other.data(), c.data());
+      return c;
+   }
+
+   constexpr gfp_unreduced add(const gfp_unreduced& other) const noexcept { return { gfp_add_wide(*this, other) }; }
+
+   constexpr gfp_unreduced sub(const gfp_unreduced& other) const noexcept { return { gfp_sub_wide(*this, other) }; }
+
+   constexpr gfp montgomery_reduce() const noexcept;
+};
+
 struct gfp : std::array<uint64_t, 4> {
 
    static constexpr gfp zero() noexcept { return {}; }
@@ -35,29 +67,39 @@ struct gfp : std::array<uint64_t, 4> {
 
    constexpr gfp mul(const gfp& other) const noexcept { return { gfp_mul(*this, other) }; }
 
-   constexpr gfp invert() const noexcept {
-      constexpr std::array<uint64_t, 4> bits = { 0x3c208c16d87cfd45, 0x97816a916871ca8d, 0xb85045b68181585d,
-                                                 0x30644e72e131a029 };
+   constexpr gfp square() const noexcept { return { gfp_sqr(*this) }; }
 
-      gfp  sum{ constants::rn1 };
-      auto power = *this;
-
-      for (auto word : bits) {
-         for (auto bit = 0; bit < 64; bit++, word >>=1) {
-            if ((word & 1) == 1) {
-               sum = sum.mul(power);
-            }
-            power = power.mul(power);
-         }
-      }
+   // canonical returns the representative in [0, p), see BN256_REDUNDANT.
+   constexpr gfp canonical() const noexcept {
+#ifdef BN256_REDUNDANT
+      return { gfp_canonical(*this) };
+#else
+      return *this;
+#endif
+   }
 
-      return sum.mul({ constants::r3 });
+   // add_unreduced returns the sum of two reduced elements without reducing it
+   // modulo p. The result is below 2p < 2²⁵⁵, so a product of two such sums is
+   // still below 4p² < p·2²⁵⁶ and can be passed to montgomery_reduce. This does
+   // not hold with BN256_REDUNDANT, where elements are only below 2p.
+   constexpr gfp add_unreduced(const gfp& other) const noexcept {
+      gfp c{};
+      addcarry_u256(false, data(), other.data(), c.data());
+      return c;
    }
 
+   constexpr gfp_unreduced mul_unreduced(const gfp& other) const noexcept { return { gfp_mul_wide(*this, other) }; }
+
+   // invert returns the inverse in the field, or 0 for 0. The Montgomery
+   // encoded aR is inverted as an integer with gfp_invert, giving a⁻¹R⁻¹, and
+   // a multiplication by R³ brings the result back to a⁻¹R.
+   constexpr gfp invert() const noexcept { return gfp{ gfp_invert(canonical()) }.mul({ constants::r3 }); }
+
    constexpr void marshal(std::span<uint8_t, 32> out) const noexcept {
+      const gfp a = canonical();
       for (auto w = 0; w < 4; w++) {
          for (auto b = 0; b < 8; b++) {
-            uint8_t t      = ((*this)[3 - w] >> (56 - 8 * b));
+            uint8_t t      = (a[3 - w] >> (56 - 8 * b));
             out[8 * w + b] = t;
          }
       }
@@ -88,18 +130,59 @@ struct gfp : std::array<uint64_t, 4> {
 #pragma clang diagnostic ignored "-Wmissing-braces"
 #endif
 
-   constexpr gfp mont_encode() const noexcept { return mul({ constants::r2 }); }
+   constexpr gfp mont_encode() const noexcept { return mul({ constants::r2 }).canonical(); }
+
+   constexpr gfp mont_decode() const noexcept { return mul(gfp{ 1 }).canonical(); }
+
+   // exp returns a^power, with power a plain little-endian integer.
+   constexpr gfp exp(const std::array<uint64_t, 4>& power) const noexcept {
+      gfp sum = gfp{ 1 }.mont_encode();
+      gfp t   = *this;
+
+      for (auto word : power) {
+         for (auto bit = 0; bit < 64; bit++, word >>= 1) {
+            if ((word & 1) == 1) {
+               sum = sum.mul(t);
+            }
+            t = t.square();
+         }
+      }
+      return sum;
+   }
+
+   // sqrt returns a^((p+1)/4), which is a square root of a whenever a has one
+   // since p = 3 mod 4. Callers have to check that the result squares to a.
+   constexpr gfp sqrt() const noexcept {
+      constexpr std::array<uint64_t, 4> p_plus_1_over_4 = { 0x4f082305b61f3f52, 0x65e05aa45a1c72a3, 0x6e14116da0605617,
+                                                            0x0c19139cb84c680a };
+      return exp(p_plus_1_over_4);
+   }
+
+   // legendre returns the quadratic character of a: 1 if a is a non-zero
+   // square, -1 if it is not a square and 0 if a is 0.
+   constexpr int legendre() const noexcept {
+      constexpr std::array<uint64_t, 4> p_minus_1_over_2 = { 0x9e10460b6c3e7ea3, 0xcbc0b548b438e546, 0xdc2822db40c0ac2e,
+                                                             0x183227397098d014 };
+      const gfp t = exp(p_minus_1_over_2);
+      if (t == gfp{}) {
+         return 0;
+      }
+      return t == gfp{ 1 }.mont_encode() ? 1 : -1;
+   }
 
-   constexpr gfp mont_decode() const noexcept { return mul(gfp{ 1 }); }
+   // sgn0 returns the parity of the canonical value of a, which tells apart a
+   // and -a for non-zero a (RFC 9380, section 4.1).
+   constexpr bool sgn0() const noexcept { return (mont_decode()[0] & 1) == 1; }
 
    std::string string() const {
       std::string result;
       result.resize(64);
 
-      auto buf = result.data();
+      const gfp a   = canonical();
+      auto      buf = result.data();
       for (int i = size() - 1; i >= 0; --i) {
          const char           hex_table[] = "0123456789abcdef";
-         const unsigned char* p           = reinterpret_cast<const unsigned char*>(&(*this)[i]) + 8;
+         const unsigned char* p           = reinterpret_cast<const unsigned char*>(&a[i]) + 8;
          for (std::size_t i = 0; i < sizeof(uint64_t); ++i) {
             unsigned x = *(--p);
             *buf++     = hex_table[(x >> 4)];
@@ -108,8 +191,18 @@ struct gfp : std::array<uint64_t, 4> {
       }
       return result;
    }
+
+   constexpr bool operator==(const gfp& rhs) const noexcept {
+      const gfp a = canonical();
+      const gfp b = rhs.canonical();
+      return static_cast<const std::array<uint64_t, 4>&>(a) == static_cast<const std::array<uint64_t, 4>&>(b);
+   }
+
+   constexpr bool operator!=(const gfp& rhs) const noexcept { return !(*this == rhs); }
 };
 
+constexpr gfp gfp_unreduced::montgomery_reduce() const noexcept { return { gfp_mont_reduce(*this) }; }
+
 constexpr gfp new_gfp(int64_t x) noexcept {
    gfp out{};
    if (x >= 0) {
@@ -121,6 +214,44 @@ constexpr gfp new_gfp(int64_t x) noexcept {
    return out.mont_encode();
 }
 
+// batch_invert_with replaces every element of elems by its inverse with
+// Montgomery's trick: a single inversion of the product of all elements and
+// 3(n-1) multiplications. Zero elements are treated as one while the product is
+// accumulated and are left as zero. scratch must hold at least elems.size()
+// elements; its contents are overwritten.
+template <typename T>
+constexpr void batch_invert_with(std::span<T> elems, std::span<T> scratch, const T& one) noexcept {
+   const std::size_t n = elems.size();
+   if (n == 0) {
+      return;
+   }
+
+   // scratch[i] is the product of elems[0..i).
+   T acc = elems[0] == T{} ? one : elems[0];
+   for (std::size_t i = 1; i < n; ++i) {
+      scratch[i] = acc;
+      acc        = acc.mul(elems[i] == T{} ? one : elems[i]);
+   }
+
+   T inv = acc.invert();
+   for (std::size_t i = n - 1; i > 0; --i) {
+      const bool is_zero = elems[i] == T{};
+      const T    t       = inv.mul(scratch[i]);
+      inv                = inv.mul(is_zero ? one : elems[i]);
+      elems[i]           = is_zero ? T{} : t;
+   }
+   elems[0] = elems[0] == T{} ? T{} : inv;
+}
+
+constexpr void batch_invert(std::span<gfp> elems, std::span<gfp> scratch) noexcept {
+   batch_invert_with(elems, scratch, new_gfp(1));
+}
+
+inline void batch_invert(std::span<gfp> elems) {
+   std::vector<gfp> scratch(elems.size());
+   batch_invert(elems, scratch);
+}
+
 #if defined (__clang__)
 #pragma clang diagnostic pop
 #endif
@@ -5,6 +5,42 @@
 
 namespace bn256 {
 
+struct gfp2;
+
+// gfp2_unreduced is a gfp2 value whose coefficients are unreduced products, see
+// gfp_unreduced.
+struct gfp2_unreduced {
+   gfp_unreduced x_;
+   gfp_unreduced y_;
+
+   constexpr gfp2_unreduced add(const gfp2_unreduced& b) const noexcept { return { x_.add(b.x_), y_.add(b.y_) }; }
+
+   constexpr gfp2_unreduced sub(const gfp2_unreduced& b) const noexcept { return { x_.sub(b.x_), y_.sub(b.y_) }; }
+
+   // mul_xi returns ξa where ξ=i+9, see gfp2::mul_xi.
+   constexpr gfp2_unreduced mul_xi() const noexcept {
+      const gfp2_unreduced& a = *this;
+
+      gfp_unreduced tx = a.x_.add(a.x_);
+      tx               = tx.add(tx);
+      tx               = tx.add(tx);
+      tx               = tx.add(a.x_);
+
+      tx = tx.add(a.y_);
+
+      gfp_unreduced ty = a.y_.add(a.y_);
+      ty               = ty.add(ty);
+      ty               = ty.add(ty);
+      ty               = ty.add(a.y_);
+
+      ty = ty.sub(a.x_);
+
+      return { tx, ty };
+   }
+
+   constexpr gfp2 montgomery_reduce() const noexcept;
+};
+
 // gfp2 implements a field of size p² as a quadratic extension of the base field
 // where i²=-1.
 struct gfp2 {
@@ -32,20 +68,30 @@ struct gfp2 {
 
    // See "Multiplication and Squaring in Pairing-Friendly Fields",
    // http://eprint.iacr.org/2006/471.pdf
-   constexpr gfp2 mul(const gfp2& b) const noexcept {
+   // mul_unreduced returns the product with both coefficients left unreduced.
+   // It uses Karatsuba's method: the cross term is recovered from
+   // (x+y)(b.x+b.y) and the two products of the real part, so three base field
+   // multiplications are needed instead of four. The sums are not reduced, which
+   // makes the cross term an exact, non-negative difference.
+   constexpr gfp2_unreduced mul_unreduced(const gfp2& b) const noexcept {
       const gfp2& a = *this;
 
-      gfp tx = a.x_.mul(b.y_);
-      gfp t  = b.x_.mul(a.y_);
-      tx     = tx.add(t);
+      gfp_unreduced v0 = a.y_.mul_unreduced(b.y_);
+      gfp_unreduced v1 = a.x_.mul_unreduced(b.x_);
 
-      gfp ty = a.y_.mul(b.y_);
-      t      = a.x_.mul(b.x_);
-      ty     = ty.sub(t);
+#ifdef BN256_REDUNDANT
+      gfp_unreduced tx = a.x_.add(a.y_).mul_unreduced(b.x_.add(b.y_));
+      tx               = tx.sub(v0).sub(v1);
+#else
+      gfp_unreduced tx = a.x_.add_unreduced(a.y_).mul_unreduced(b.x_.add_unreduced(b.y_));
+      tx               = tx.sub_unreduced(v0).sub_unreduced(v1);
+#endif
 
-      return { tx, ty };
+      return { tx, v0.sub(v1) };
    }
 
+   constexpr gfp2 mul(const gfp2& b) const noexcept { return mul_unreduced(b).montgomery_reduce(); }
+
    constexpr gfp2 mul_scalar(const gfp& b) const noexcept { return { x_.mul(b), y_.mul(b) }; }
 
    // MulXi sets e=ξa where ξ=i+9 and then returns e.
@@ -84,13 +130,22 @@ struct gfp2 {
       return { tx, ty };
    }
 
+   constexpr gfp2_unreduced square_unreduced() const noexcept {
+      const gfp2& a = *this;
+
+      gfp tx = a.x_.add(a.x_);
+      gfp ty = a.x_.add(a.y_);
+
+      return { tx.mul_unreduced(a.y_), a.y_.sub(a.x_).mul_unreduced(ty) };
+   }
+
    constexpr gfp2 invert() const noexcept {
       const gfp2& a = *this;
 
       // See "Implementing cryptographic pairings", M. Scott, section 3.2.
       // ftp://136.206.11.249/pub/crypto/pairings.pdf
-      gfp t1 = a.x_.mul(a.x_);
-      gfp t2 = a.y_.mul(a.y_);
+      gfp t1 = a.x_.square();
+      gfp t2 = a.y_.square();
       t1     = t1.add(t2);
 
       gfp inv = t1.invert();
@@ -100,6 +155,43 @@ struct gfp2 {
       return { t1.mul(inv), a.y_.mul(inv) };
    }
 
+   // legendre returns the quadratic character of a, which is the one of its
+   // norm x²+y² in the base field.
+   constexpr int legendre() const noexcept { return x_.square().add(y_.square()).legendre(); }
+
+   // sqrt returns a square root of a whenever a has one, using the complex
+   // method for p = 3 mod 4: with n = √(x²+y²), the real part of the root is
+   // √((y±n)/2) for the sign that makes the radicand a square, and the imaginary
+   // part follows from x. Callers have to check that the result squares to a.
+   constexpr gfp2 sqrt() const noexcept {
+      const gfp2& a = *this;
+
+      if (a.x_ == gfp{}) {
+         // Either y or -y is a square, as -1 is not.
+         gfp t = a.y_.sqrt();
+         if (t.square() == a.y_) {
+            return { {}, t };
+         }
+         return { a.y_.neg().sqrt(), {} };
+      }
+
+      constexpr gfp half = new_gfp(2).invert();
+      const gfp n    = a.x_.square().add(a.y_.square()).sqrt();
+
+      gfp delta = a.y_.add(n).mul(half);
+      gfp t     = delta.sqrt();
+      if (t.square() != delta) {
+         delta = a.y_.sub(n).mul(half);
+         t     = delta.sqrt();
+      }
+
+      return { a.x_.mul(t.add(t).invert()), t };
+   }
+
+   // sgn0 returns the sign of a as defined in RFC 9380, section 4.1: the parity
+   // of the real part, or of the imaginary part if the real part is zero.
+   constexpr bool sgn0() const noexcept { return y_ == gfp{} ? x_.sgn0() : y_.sgn0(); }
+
    std::string string() const { return "(" + x_.string() + ", " + y_.string() + ")"; }
 
    friend std::ostream& operator<<(std::ostream& os, const gfp2& v) { return os << "(" << v.x_ << ", " << v.y_ << ")"; }
@@ -112,6 +204,20 @@ struct gfp2 {
    constexpr bool operator!=(const gfp2& rhs) const noexcept { return !(*this == rhs); }
 };
 
+constexpr gfp2 gfp2_unreduced::montgomery_reduce() const noexcept {
+   return { x_.montgomery_reduce(), y_.montgomery_reduce() };
+}
+
+// batch_invert inverts all elements with one inversion, see batch_invert_with.
+constexpr void batch_invert(std::span<gfp2> elems, std::span<gfp2> scratch) noexcept {
+   batch_invert_with(elems, scratch, gfp2::one());
+}
+
+inline void batch_invert(std::span<gfp2> elems) {
+   std::vector<gfp2> scratch(elems.size());
+   batch_invert(elems, scratch);
+}
+
 namespace constants {
 #if defined (__clang__)
 #pragma clang diagnostic push
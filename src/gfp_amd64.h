@@ -0,0 +1,242 @@
+#pragma once
+#include <array>
+#include <cstdint>
+
+#if defined(__amd64__) && defined(__BMI2__) && defined(__ADX__)
+#   define BN256_HAS_ADX 1
+
+namespace bn256 {
+
+// One round of the CIOS Montgomery multiplication: t += a·bᵢ, then
+// t += m·p with m = t₀·np₀ mod 2⁶⁴, which clears t₀. MULX leaves the flags
+// alone, so the low halves of the products are accumulated on the OF chain
+// (ADOX) while the high halves run on the CF chain (ADCX). The six words of t
+// are passed rotated: after the round t₀ is zero and becomes the top word of
+// the next one.
+#   define BN256_MONT_ROUND(bi, t0, t1, t2, t3, t4, t5)                                                                \
+      "movq %[" #bi "], %%rdx\n\t"                                                                                     \
+      "xorl %%eax, %%eax\n\t"                                                                                          \
+      "mulxq %[a0], %[lo], %[hi]\n\t"                                                                                  \
+      "adoxq %[lo], %[" #t0 "]\n\t"                                                                                    \
+      "adcxq %[hi], %[" #t1 "]\n\t"                                                                                    \
+      "mulxq %[a1], %[lo], %[hi]\n\t"                                                                                  \
+      "adoxq %[lo], %[" #t1 "]\n\t"                                                                                    \
+      "adcxq %[hi], %[" #t2 "]\n\t"                                                                                    \
+      "mulxq %[a2], %[lo], %[hi]\n\t"                                                                                  \
+      "adoxq %[lo], %[" #t2 "]\n\t"                                                                                    \
+      "adcxq %[hi], %[" #t3 "]\n\t"                                                                                    \
+      "mulxq %[a3], %[lo], %[hi]\n\t"                                                                                  \
+      "adoxq %[lo], %[" #t3 "]\n\t"                                                                                    \
+      "adcxq %[hi], %[" #t4 "]\n\t"                                                                                    \
+      "adcxq %%rax, %[" #t5 "]\n\t"                                                                                    \
+      "adoxq %%rax, %[" #t4 "]\n\t"                                                                                    \
+      "adoxq %%rax, %[" #t5 "]\n\t"                                                                                    \
+      "movq %[" #t0 "], %%rdx\n\t"                                                                                     \
+      "imulq %[np0], %%rdx\n\t"                                                                                        \
+      "xorl %%eax, %%eax\n\t"                                                                                          \
+      "mulxq %[p0], %[lo], %[hi]\n\t"                                                                                  \
+      "adoxq %[lo], %[" #t0 "]\n\t"                                                                                    \
+      "adcxq %[hi], %[" #t1 "]\n\t"                                                                                    \
+      "mulxq %[p1], %[lo], %[hi]\n\t"                                                                                  \
+      "adoxq %[lo], %[" #t1 "]\n\t"                                                                                    \
+      "adcxq %[hi], %[" #t2 "]\n\t"                                                                                    \
+      "mulxq %[p2], %[lo], %[hi]\n\t"                                                                                  \
+      "adoxq %[lo], %[" #t2 "]\n\t"                                                                                    \
+      "adcxq %[hi], %[" #t3 "]\n\t"                                                                                    \
+      "mulxq %[p3], %[lo], %[hi]\n\t"                                                                                  \
+      "adoxq %[lo], %[" #t3 "]\n\t"                                                                                    \
+      "adcxq %[hi], %[" #t4 "]\n\t"                                                                                    \
+      "adcxq %%rax, %[" #t5 "]\n\t"                                                                                    \
+      "adoxq %%rax, %[" #t4 "]\n\t"                                                                                    \
+      "adoxq %%rax, %[" #t5 "]\n\t"
+
+// mont_mul_adx sets c to (a·b + m·p)/2²⁵⁶, where m < 2²⁵⁶ is chosen so that the
+// division is exact, and returns bit 256 of the result. This is the same value
+// the portable gfp_mul computes before its final conditional subtraction, for
+// any 256-bit a and b.
+inline uint64_t mont_mul_adx(const std::array<uint64_t, 4>& a, const std::array<uint64_t, 4>& b,
+                             const std::array<uint64_t, 4>& p, uint64_t np0, std::array<uint64_t, 4>& c) noexcept {
+   uint64_t t0 = 0, t1 = 0, t2 = 0, t3 = 0, t4 = 0, t5 = 0, lo, hi;
+
+   __asm__(BN256_MONT_ROUND(b0, t0, t1, t2, t3, t4, t5) //
+           BN256_MONT_ROUND(b1, t1, t2, t3, t4, t5, t0) //
+           BN256_MONT_ROUND(b2, t2, t3, t4, t5, t0, t1) //
+           BN256_MONT_ROUND(b3, t3, t4, t5, t0, t1, t2)
+           : [t0] "+r"(t0), [t1] "+r"(t1), [t2] "+r"(t2), [t3] "+r"(t3), [t4] "+r"(t4), [t5] "+r"(t5),
+             [lo] "=&r"(lo), [hi] "=&r"(hi)
+           : [a0] "m"(a[0]), [a1] "m"(a[1]), [a2] "m"(a[2]), [a3] "m"(a[3]), [b0] "m"(b[0]), [b1] "m"(b[1]),
+             [b2] "m"(b[2]), [b3] "m"(b[3]), [p0] "m"(p[0]), [p1] "m"(p[1]), [p2] "m"(p[2]), [p3] "m"(p[3]),
+             [np0] "m"(np0)
+           : "rax", "rdx", "cc");
+
+   c = { t4, t5, t0, t1 };
+   return t2;
+}
+
+// One row of the schoolbook product: t += a·bᵢ·2^(64i). MULX leaves the flags
+// alone, so the low halves are accumulated on the OF chain and the high halves
+// on the CF chain. u is a zero register and t4 is written by the last MULX.
+#   define BN256_MUL_ROW(bi, t0, t1, t2, t3, t4)                                                                      \
+      "movq %[" #bi "], %%rdx\n\t"                                                                                     \
+      "xorl %k[u], %k[u]\n\t"                                                                                          \
+      "mulxq %[a0], %[lo], %[hi]\n\t"                                                                                  \
+      "adoxq %[lo], %[" #t0 "]\n\t"                                                                                    \
+      "adcxq %[hi], %[" #t1 "]\n\t"                                                                                    \
+      "mulxq %[a1], %[lo], %[hi]\n\t"                                                                                  \
+      "adoxq %[lo], %[" #t1 "]\n\t"                                                                                    \
+      "adcxq %[hi], %[" #t2 "]\n\t"                                                                                    \
+      "mulxq %[a2], %[lo], %[hi]\n\t"                                                                                  \
+      "adoxq %[lo], %[" #t2 "]\n\t"                                                                                    \
+      "adcxq %[hi], %[" #t3 "]\n\t"                                                                                    \
+      "mulxq %[a3], %[lo], %[" #t4 "]\n\t"                                                                             \
+      "adoxq %[lo], %[" #t3 "]\n\t"                                                                                    \
+      "adcxq %[u], %[" #t4 "]\n\t"                                                                                     \
+      "adoxq %[u], %[" #t4 "]\n\t"
+
+// mul_wide_adx sets c to the 512-bit product a·b.
+inline void mul_wide_adx(const std::array<uint64_t, 4>& a, const std::array<uint64_t, 4>& b,
+                         std::array<uint64_t, 8>& c) noexcept {
+   uint64_t t0, t1, t2, t3, t4, t5, t6, t7, lo, hi, u;
+
+   __asm__("movq %[b0], %%rdx\n\t"
+           "mulxq %[a0], %[t0], %[t1]\n\t"
+           "mulxq %[a1], %[lo], %[t2]\n\t"
+           "addq %[lo], %[t1]\n\t"
+           "mulxq %[a2], %[lo], %[t3]\n\t"
+           "adcq %[lo], %[t2]\n\t"
+           "mulxq %[a3], %[lo], %[t4]\n\t"
+           "adcq %[lo], %[t3]\n\t"
+           "adcq $0, %[t4]\n\t" //
+           BN256_MUL_ROW(b1, t1, t2, t3, t4, t5) //
+           BN256_MUL_ROW(b2, t2, t3, t4, t5, t6) //
+           BN256_MUL_ROW(b3, t3, t4, t5, t6, t7)
+           : [t0] "=&r"(t0), [t1] "=&r"(t1), [t2] "=&r"(t2), [t3] "=&r"(t3), [t4] "=&r"(t4), [t5] "=&r"(t5),
+             [t6] "=&r"(t6), [t7] "=&r"(t7), [lo] "=&r"(lo), [hi] "=&r"(hi), [u] "=&r"(u)
+           : [a0] "m"(a[0]), [a1] "m"(a[1]), [a2] "m"(a[2]), [a3] "m"(a[3]), [b0] "m"(b[0]), [b1] "m"(b[1]),
+             [b2] "m"(b[2]), [b3] "m"(b[3])
+           : "rdx", "cc");
+
+   c = { t0, t1, t2, t3, t4, t5, t6, t7 };
+}
+
+#   undef BN256_MUL_ROW
+
+// One round of Montgomery reduction on the low half of a square: t += m·p
+// with m = t₀·np₀ mod 2⁶⁴. c is zero on entry; t₀ is zero on exit and serves as
+// the zero register for the last carry.
+#   define BN256_REDC_ROUND(t0, t1, t2, t3, c)                                                                         \
+      "movq %[" #t0 "], %%rdx\n\t"                                                                                     \
+      "imulq %[np0], %%rdx\n\t"                                                                                        \
+      "xorl %k[" #c "], %k[" #c "]\n\t"                                                                                \
+      "mulxq %[p0], %[lo], %[hi]\n\t"                                                                                  \
+      "adoxq %[lo], %[" #t0 "]\n\t"                                                                                    \
+      "adcxq %[hi], %[" #t1 "]\n\t"                                                                                    \
+      "mulxq %[p1], %[lo], %[hi]\n\t"                                                                                  \
+      "adoxq %[lo], %[" #t1 "]\n\t"                                                                                    \
+      "adcxq %[hi], %[" #t2 "]\n\t"                                                                                    \
+      "mulxq %[p2], %[lo], %[hi]\n\t"                                                                                  \
+      "adoxq %[lo], %[" #t2 "]\n\t"                                                                                    \
+      "adcxq %[hi], %[" #t3 "]\n\t"                                                                                    \
+      "mulxq %[p3], %[lo], %[hi]\n\t"                                                                                  \
+      "adoxq %[lo], %[" #t3 "]\n\t"                                                                                    \
+      "adcxq %[hi], %[" #c "]\n\t"                                                                                     \
+      "adoxq %[" #t0 "], %[" #c "]\n\t"
+
+// mont_sqr_adx is mont_mul_adx(a, a, p, np0, c). The 512-bit square is formed
+// first, with each cross product a[i]·a[j] computed once and doubled, and its
+// low half is then reduced word by word and added to the high half.
+inline uint64_t mont_sqr_adx(const std::array<uint64_t, 4>& a, const std::array<uint64_t, 4>& p, uint64_t np0,
+                             std::array<uint64_t, 4>& c) noexcept {
+   uint64_t t0, t1, t2, t3, t4, t5, t6, t7, lo, hi, u;
+
+   __asm__("movq %[a0], %%rdx\n\t"
+           "mulxq %[a1], %[t1], %[t2]\n\t"
+           "mulxq %[a2], %[lo], %[t3]\n\t"
+           "addq %[lo], %[t2]\n\t"
+           "mulxq %[a3], %[lo], %[t4]\n\t"
+           "adcq %[lo], %[t3]\n\t"
+           "adcq $0, %[t4]\n\t"
+           "movq %[a1], %%rdx\n\t"
+           "mulxq %[a2], %[lo], %[hi]\n\t"
+           "mulxq %[a3], %[u], %[t5]\n\t"
+           "addq %[lo], %[t3]\n\t"
+           "adcq %[hi], %[t4]\n\t"
+           "adcq $0, %[t5]\n\t"
+           "addq %[u], %[t4]\n\t"
+           "adcq $0, %[t5]\n\t"
+           "movq %[a2], %%rdx\n\t"
+           "mulxq %[a3], %[lo], %[t6]\n\t"
+           "addq %[lo], %[t5]\n\t"
+           "adcq $0, %[t6]\n\t"
+           "xorl %k[t7], %k[t7]\n\t"
+           "addq %[t1], %[t1]\n\t"
+           "adcq %[t2], %[t2]\n\t"
+           "adcq %[t3], %[t3]\n\t"
+           "adcq %[t4], %[t4]\n\t"
+           "adcq %[t5], %[t5]\n\t"
+           "adcq %[t6], %[t6]\n\t"
+           "adcq %[t7], %[t7]\n\t"
+           "movq %[a0], %%rdx\n\t"
+           "mulxq %%rdx, %[t0], %[hi]\n\t"
+           "addq %[hi], %[t1]\n\t"
+           "movq %[a1], %%rdx\n\t"
+           "mulxq %%rdx, %[lo], %[hi]\n\t"
+           "adcq %[lo], %[t2]\n\t"
+           "adcq %[hi], %[t3]\n\t"
+           "movq %[a2], %%rdx\n\t"
+           "mulxq %%rdx, %[lo], %[hi]\n\t"
+           "adcq %[lo], %[t4]\n\t"
+           "adcq %[hi], %[t5]\n\t"
+           "movq %[a3], %%rdx\n\t"
+           "mulxq %%rdx, %[lo], %[hi]\n\t"
+           "adcq %[lo], %[t6]\n\t"
+           "adcq %[hi], %[t7]\n\t" //
+           BN256_REDC_ROUND(t0, t1, t2, t3, u)                                //
+           BN256_REDC_ROUND(t1, t2, t3, u, t0)                                //
+           BN256_REDC_ROUND(t2, t3, u, t0, t1)                                //
+           BN256_REDC_ROUND(t3, u, t0, t1, t2)                                //
+           "addq %[u], %[t4]\n\t"
+           "adcq %[t0], %[t5]\n\t"
+           "adcq %[t1], %[t6]\n\t"
+           "adcq %[t2], %[t7]\n\t"
+           "adcq %[t3], %[t3]\n\t"
+           : [t0] "=&r"(t0), [t1] "=&r"(t1), [t2] "=&r"(t2), [t3] "=&r"(t3), [t4] "=&r"(t4), [t5] "=&r"(t5),
+             [t6] "=&r"(t6), [t7] "=&r"(t7), [lo] "=&r"(lo), [hi] "=&r"(hi), [u] "=&r"(u)
+           : [a0] "m"(a[0]), [a1] "m"(a[1]), [a2] "m"(a[2]), [a3] "m"(a[3]), [p0] "m"(p[0]), [p1] "m"(p[1]),
+             [p2] "m"(p[2]), [p3] "m"(p[3]), [np0] "m"(np0)
+           : "rdx", "cc");
+
+   c = { t4, t5, t6, t7 };
+   return t3;
+}
+
+// mont_reduce_adx sets c to (T + m·p)/2²⁵⁶, where m < 2²⁵⁶ is chosen so that
+// the division is exact, and returns bit 256 of the result.
+inline uint64_t mont_reduce_adx(const std::array<uint64_t, 8>& T, const std::array<uint64_t, 4>& p, uint64_t np0,
+                                std::array<uint64_t, 4>& c) noexcept {
+   uint64_t t0 = T[0], t1 = T[1], t2 = T[2], t3 = T[3], t4 = T[4], t5 = T[5], t6 = T[6], t7 = T[7], lo, hi, u;
+
+   __asm__(BN256_REDC_ROUND(t0, t1, t2, t3, u) //
+           BN256_REDC_ROUND(t1, t2, t3, u, t0) //
+           BN256_REDC_ROUND(t2, t3, u, t0, t1) //
+           BN256_REDC_ROUND(t3, u, t0, t1, t2) //
+           "addq %[u], %[t4]\n\t"
+           "adcq %[t0], %[t5]\n\t"
+           "adcq %[t1], %[t6]\n\t"
+           "adcq %[t2], %[t7]\n\t"
+           "adcq %[t3], %[t3]\n\t"
+           : [t0] "+r"(t0), [t1] "+r"(t1), [t2] "+r"(t2), [t3] "+r"(t3), [t4] "+r"(t4), [t5] "+r"(t5),
+             [t6] "+r"(t6), [t7] "+r"(t7), [lo] "=&r"(lo), [hi] "=&r"(hi), [u] "=&r"(u)
+           : [p0] "m"(p[0]), [p1] "m"(p[1]), [p2] "m"(p[2]), [p3] "m"(p[3]), [np0] "m"(np0)
+           : "rdx", "cc");
+
+   c = { t4, t5, t6, t7 };
+   return t3;
+}
+
+#   undef BN256_REDC_ROUND
+#   undef BN256_MONT_ROUND
+
+} // namespace bn256
+
+#endif
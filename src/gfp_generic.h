@@ -1,6 +1,7 @@
 #pragma once
 #include "array.h"
 #include "bitint_arithmetic.h"
+#include "gfp_amd64.h"
 #include <cstddef>
 namespace bn256 {
 
@@ -13,6 +14,10 @@ namespace constants {
    inline constexpr std::array<uint64_t, 4> np = { 0x87d20782e4866389, 0x9ede7d651eca6ac9, 0xd8afcbd01833da80,
                                                    0xf57a22b791888c6b };
 
+   // two_p is 2p, represented as little-endian 64-bit words.
+   inline constexpr std::array<uint64_t, 4> two_p = { 0x7841182db0f9fa8e, 0x2f02d522d0e3951a, 0x70a08b6d0302b0bb,
+                                                      0x60c89ce5c2634053 };
+
 } // namespace constants
 
 constexpr std::array<uint64_t, 4> gfp_carry(const std::array<uint64_t, 4>& a, uint64_t head) noexcept {
@@ -24,6 +29,47 @@ constexpr std::array<uint64_t, 4> gfp_carry(const std::array<uint64_t, 4>& a, ui
    return carry ? a : b;
 }
 
+// gfp_canonical brings a value in [0, 2p) into [0, p).
+constexpr std::array<uint64_t, 4> gfp_canonical(const std::array<uint64_t, 4>& a) noexcept { return gfp_carry(a, 0); }
+
+#ifdef BN256_REDUNDANT
+// With BN256_REDUNDANT field elements are kept in [0, 2p) instead of [0, p).
+// Since 4p < 2²⁵⁶, Montgomery multiplication of such values already returns a
+// result below 2p, so the final conditional subtraction is skipped; additions
+// and subtractions reduce modulo 2p. Values are brought back into [0, p) by
+// gfp_canonical wherever their representation is observed.
+
+// gfp_carry2 brings a value in [0, 4p) into [0, 2p).
+constexpr std::array<uint64_t, 4> gfp_carry2(const std::array<uint64_t, 4>& a) noexcept {
+   std::array<uint64_t, 4> b{};
+   bool                    carry = subborrow_u256(false, a.data(), constants::two_p.data(), b.data());
+   return carry ? a : b;
+}
+
+constexpr std::array<uint64_t, 4> gfp_neg(const std::array<uint64_t, 4>& a) noexcept {
+   std::array<uint64_t, 4> b{};
+   subborrow_u256(false, constants::two_p.data(), a.data(), b.data());
+   return gfp_carry2(b);
+}
+
+constexpr std::array<uint64_t, 4> gfp_add(const std::array<uint64_t, 4>& a, const std::array<uint64_t, 4>& b) noexcept {
+   std::array<uint64_t, 4> c{};
+   addcarry_u256(false, a.data(), b.data(), c.data());
+   return gfp_carry2(c);
+}
+
+constexpr std::array<uint64_t, 4> gfp_sub(const std::array<uint64_t, 4>& a, const std::array<uint64_t, 4>& b) noexcept {
+   std::array<uint64_t, 4> t{};
+   subborrow_u256(false, constants::two_p.data(), b.data(), t.data());
+   std::array<uint64_t, 4> c{};
+   addcarry_u256(false, a.data(), t.data(), c.data());
+   return gfp_carry2(c);
+}
+
+// gfp_mont_carry finishes a Montgomery multiplication or reduction whose result,
+// before the final subtraction, is c + head·2²⁵⁶.
+constexpr std::array<uint64_t, 4> gfp_mont_carry(const std::array<uint64_t, 4>& c, uint64_t) noexcept { return c; }
+#else
 constexpr std::array<uint64_t, 4> gfp_neg(const std::array<uint64_t, 4>& a) noexcept {
    std::array<uint64_t, 4> b{};
    subborrow_u256(false, constants::p2.data(), a.data(), b.data());
@@ -44,10 +90,58 @@ constexpr std::array<uint64_t, 4> gfp_sub(const std::array<uint64_t, 4>& a, cons
    return gfp_carry(c, carry);
 }
 
+
+constexpr std::array<uint64_t, 4> gfp_mont_carry(const std::array<uint64_t, 4>& c, uint64_t head) noexcept {
+   return gfp_carry(c, head);
+}
+#endif
+
+// gfp_mul_wide computes the 512-bit product a·b, leaving its Montgomery
+// reduction to the caller.
 [[gnu::hot]]
-constexpr std::array<uint64_t, 4> gfp_mul(const std::array<uint64_t, 4>& a, const std::array<uint64_t, 4>& b) noexcept {
-   std::array<uint64_t, 8> T = {};
-   full_mul_u256(a.data(), b.data(), T.data());
+constexpr std::array<uint64_t, 8> gfp_mul_wide(const std::array<uint64_t, 4>& a,
+                                               const std::array<uint64_t, 4>& b) noexcept {
+   std::array<uint64_t, 8> c{};
+#ifdef BN256_HAS_ADX
+   if (!std::is_constant_evaluated()) {
+      mul_wide_adx(a, b, c);
+      return c;
+   }
+#endif
+   full_mul_u256(a.data(), b.data(), c.data());
+   return c;
+}
+
+// gfp_add_wide adds two 512-bit values below p·2²⁵⁶ and subtracts p·2²⁵⁶ from
+// the sum if needed, so that it stays in that range.
+constexpr std::array<uint64_t, 8> gfp_add_wide(const std::array<uint64_t, 8>& a,
+                                               const std::array<uint64_t, 8>& b) noexcept {
+   std::array<uint64_t, 8> c{};
+   std::array<uint64_t, 4> h{};
+   bool                    carry = addcarry_u256(false, a.data(), b.data(), c.data());
+   carry                         = addcarry_u256(carry, a.data() + 4, b.data() + 4, h.data());
+   h                             = gfp_carry(h, carry);
+   c[4] = h[0], c[5] = h[1], c[6] = h[2], c[7] = h[3];
+   return c;
+}
+
+// gfp_sub_wide subtracts two 512-bit values below p·2²⁵⁶ and adds p·2²⁵⁶ to the
+// difference if it is negative.
+constexpr std::array<uint64_t, 8> gfp_sub_wide(const std::array<uint64_t, 8>& a,
+                                               const std::array<uint64_t, 8>& b) noexcept {
+   std::array<uint64_t, 8> c{};
+   bool                    borrow = subborrow_u512(false, a.data(), b.data(), c.data());
+   const uint64_t          mask   = -uint64_t(borrow);
+   std::array<uint64_t, 4> h      = { constants::p2[0] & mask, constants::p2[1] & mask, constants::p2[2] & mask,
+                                      constants::p2[3] & mask };
+   addcarry_u256(false, c.data() + 4, h.data(), c.data() + 4);
+   return c;
+}
+
+// gfp_mont_reduce computes T·2⁻²⁵⁶ mod p for a 512-bit T (Montgomery
+// reduction). The result is fully reduced whenever T < p·2²⁵⁶.
+[[gnu::hot]]
+constexpr std::array<uint64_t, 4> gfp_mont_reduce_generic(std::array<uint64_t, 8> T) noexcept {
    std::array<uint64_t, 4> m = {};
    half_mul_u256(T.data(), constants::np.data(), m.data());
    std::array<uint64_t, 8> t = {};
@@ -57,7 +151,116 @@ constexpr std::array<uint64_t, 4> gfp_mul(const std::array<uint64_t, 4>& a, cons
    carry      = addcarry_u256(carry, T.data(), t.data(), T.data());
    carry      = addcarry_u256(carry, T.data() + 4, t.data() + 4, T.data() + 4);
 
-   return gfp_carry({ T[4], T[5], T[6], T[7] }, carry);
+   return gfp_mont_carry({ T[4], T[5], T[6], T[7] }, carry);
+}
+
+// gfp_mont_reduce_cios reduces T one word at a time, like the second half of
+// each round of gfp_mul_cios: m = t₀·np₀ mod 2⁶⁴ and m·p is added, which clears
+// the lowest word. The carries out of each round are collected in extra and
+// added with the next one.
+[[gnu::hot]]
+constexpr std::array<uint64_t, 4> gfp_mont_reduce_cios(std::array<uint64_t, 8> T) noexcept {
+   const uint64_t np0   = constants::np[0];
+   const auto&    p     = constants::p2;
+   uint64_t       extra = 0, carry = 0, m = 0;
+
+   for (int i = 0; i < 4; ++i) {
+      m = T[i] * np0;
+      mac_u64(m, p[0], T[i], 0, &carry);
+      T[i + 1] = mac_u64(m, p[1], T[i + 1], carry, &carry);
+      T[i + 2] = mac_u64(m, p[2], T[i + 2], carry, &carry);
+      T[i + 3] = mac_u64(m, p[3], T[i + 3], carry, &carry);
+      T[i + 4] = mac_u64(1, T[i + 4], carry, extra, &extra);
+   }
+
+   return gfp_mont_carry({ T[4], T[5], T[6], T[7] }, extra);
+}
+
+[[gnu::hot]]
+constexpr std::array<uint64_t, 4> gfp_mont_reduce(const std::array<uint64_t, 8>& T) noexcept {
+#ifdef BN256_HAS_ADX
+   if (!std::is_constant_evaluated()) {
+      std::array<uint64_t, 4> c{};
+      uint64_t                head = mont_reduce_adx(T, constants::p2, constants::np[0], c);
+      return gfp_mont_carry(c, head);
+   }
+#endif
+#ifdef BN256_MONT_CIOS
+   return gfp_mont_reduce_cios(T);
+#else
+   return gfp_mont_reduce_generic(T);
+#endif
+}
+
+[[gnu::hot]]
+constexpr std::array<uint64_t, 4> gfp_mul_generic(const std::array<uint64_t, 4>& a,
+                                                  const std::array<uint64_t, 4>& b) noexcept {
+   std::array<uint64_t, 8> T = {};
+   full_mul_u256(a.data(), b.data(), T.data());
+   return gfp_mont_reduce_generic(T);
+}
+
+// gfp_mul_cios is the word-by-word (CIOS) Montgomery multiplication: each word
+// of b is multiplied into the accumulator, which is then shifted down by one
+// word after adding m·p with m = t₀·np₀ mod 2⁶⁴. Only np₀, the low word of
+// -p⁻¹, is needed and the accumulator stays in six registers. It computes the
+// same value as gfp_mul_generic for any 256-bit a and b.
+[[gnu::hot]]
+constexpr std::array<uint64_t, 4> gfp_mul_cios(const std::array<uint64_t, 4>& a,
+                                               const std::array<uint64_t, 4>& b) noexcept {
+   const uint64_t np0 = constants::np[0];
+   const auto&    p   = constants::p2;
+   uint64_t       t0 = 0, t1 = 0, t2 = 0, t3 = 0, t4 = 0, t5 = 0, carry = 0, m = 0;
+
+   for (int i = 0; i < 4; ++i) {
+      t0 = mac_u64(a[0], b[i], t0, 0, &carry);
+      t1 = mac_u64(a[1], b[i], t1, carry, &carry);
+      t2 = mac_u64(a[2], b[i], t2, carry, &carry);
+      t3 = mac_u64(a[3], b[i], t3, carry, &carry);
+      t4 = mac_u64(1, t4, carry, 0, &t5);
+
+      m = t0 * np0;
+      mac_u64(m, p[0], t0, 0, &carry);
+      t0 = mac_u64(m, p[1], t1, carry, &carry);
+      t1 = mac_u64(m, p[2], t2, carry, &carry);
+      t2 = mac_u64(m, p[3], t3, carry, &carry);
+      t3 = mac_u64(1, t4, carry, 0, &carry);
+      t4 = t5 + carry;
+   }
+
+   return gfp_mont_carry({ t0, t1, t2, t3 }, t4);
+}
+
+[[gnu::hot]]
+constexpr std::array<uint64_t, 4> gfp_mul(const std::array<uint64_t, 4>& a, const std::array<uint64_t, 4>& b) noexcept {
+#ifdef BN256_HAS_ADX
+   if (!std::is_constant_evaluated()) {
+      std::array<uint64_t, 4> c{};
+      uint64_t                head = mont_mul_adx(a, b, constants::p2, constants::np[0], c);
+      return gfp_mont_carry(c, head);
+   }
+#endif
+#ifdef BN256_MONT_CIOS
+   return gfp_mul_cios(a, b);
+#else
+   return gfp_mul_generic(a, b);
+#endif
+}
+
+// gfp_sqr computes a·a like gfp_mul(a, a), but forms each cross product of the
+// limbs only once.
+[[gnu::hot]]
+constexpr std::array<uint64_t, 4> gfp_sqr(const std::array<uint64_t, 4>& a) noexcept {
+#ifdef BN256_HAS_ADX
+   if (!std::is_constant_evaluated()) {
+      std::array<uint64_t, 4> c{};
+      uint64_t                head = mont_sqr_adx(a, constants::p2, constants::np[0], c);
+      return gfp_mont_carry(c, head);
+   }
+#endif
+   std::array<uint64_t, 8> T = {};
+   full_sqr_u256(a.data(), T.data());
+   return gfp_mont_reduce(T);
 }
 
 } // namespace bn256
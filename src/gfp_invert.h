@@ -0,0 +1,249 @@
+#pragma once
+#include "gfp_generic.h"
+#include <cstdint>
+
+namespace bn256 {
+
+// Constant-time modular inversion with the "safegcd" divstep algorithm of
+// Bernstein and Yang, "Fast constant-time gcd computation and modular
+// inversion", https://eprint.iacr.org/2019/266.pdf. The layout follows the
+// 62-bit signed limb variant of libsecp256k1 (src/modinv64_impl.h): numbers
+// are five int64_t limbs of 62 bits each, and divsteps are applied 59 at a time
+// through a 2x2 transition matrix whose entries fit in a 64-bit word.
+//
+// The code is branch-free and its running time does not depend on the input.
+namespace safegcd {
+
+   struct signed62 {
+      int64_t v[5];
+   };
+
+   // trans2x2 is the transition matrix of 59 divsteps, scaled by 2⁶².
+   struct trans2x2 {
+      int64_t u, v, q, r;
+   };
+
+   inline constexpr uint64_t m62 = UINT64_MAX >> 2;
+
+   constexpr signed62 from_u256(const std::array<uint64_t, 4>& a) noexcept {
+      return { { int64_t(a[0] & m62), int64_t((a[0] >> 62 | a[1] << 2) & m62),
+                 int64_t((a[1] >> 60 | a[2] << 4) & m62), int64_t((a[2] >> 58 | a[3] << 6) & m62),
+                 int64_t(a[3] >> 56) } };
+   }
+
+   // to_u256 expects a value in [0, p), with all limbs in [0, 2⁶²).
+   constexpr std::array<uint64_t, 4> to_u256(const signed62& a) noexcept {
+      const uint64_t v0 = a.v[0], v1 = a.v[1], v2 = a.v[2], v3 = a.v[3], v4 = a.v[4];
+      return { v0 | v1 << 62, v1 >> 2 | v2 << 60, v2 >> 4 | v3 << 58, v3 >> 6 | v4 << 56 };
+   }
+
+   // modulus is p in signed62 form and modulus_inv62 is p⁻¹ mod 2⁶², which is
+   // -np mod 2⁶².
+   inline constexpr signed62 modulus       = from_u256(constants::p2);
+   inline constexpr uint64_t modulus_inv62 = (0 - constants::np[0]) & m62;
+
+   // divsteps_59 applies 59 divsteps to the low words of f and g, starting from
+   // zeta = -(delta+1/2), and returns the new zeta together with the transition
+   // matrix t.
+   constexpr int64_t divsteps_59(int64_t zeta, uint64_t f0, uint64_t g0, trans2x2& t) noexcept {
+      uint64_t u = 8, v = 0, q = 0, r = 8;
+      uint64_t f = f0, g = g0;
+
+      for (int i = 3; i < 62; ++i) {
+         // f is always odd. If zeta < 0 and g is odd, (f, g) becomes (g, (g-f)/2),
+         // otherwise it becomes (f, (g + (g&1)·f)/2).
+         uint64_t       c1    = uint64_t(zeta >> 63);
+         const uint64_t c2    = 0 - (g & 1);
+         const uint64_t x     = (f ^ c1) - c1;
+         const uint64_t y     = (u ^ c1) - c1;
+         const uint64_t z     = (v ^ c1) - c1;
+         g += x & c2;
+         q += y & c2;
+         r += z & c2;
+         c1 &= c2;
+         zeta = (zeta ^ int64_t(c1)) - 1;
+         f += g & c1;
+         u += q & c1;
+         v += r & c1;
+         g >>= 1;
+         u <<= 1;
+         v <<= 1;
+      }
+      t = { int64_t(u), int64_t(v), int64_t(q), int64_t(r) };
+      return zeta;
+   }
+
+   // update_de computes (t·[d, e] + p·[md, me]) / 2⁶², choosing md and me so that
+   // the division is exact. d and e stay in (-2p, p).
+   constexpr void update_de(signed62& d, signed62& e, const trans2x2& t) noexcept {
+      const int64_t d0 = d.v[0], d1 = d.v[1], d2 = d.v[2], d3 = d.v[3], d4 = d.v[4];
+      const int64_t e0 = e.v[0], e1 = e.v[1], e2 = e.v[2], e3 = e.v[3], e4 = e.v[4];
+      const int64_t u = t.u, v = t.v, q = t.q, r = t.r;
+
+      // md and me start as [u, q] if d is negative plus [v, r] if e is negative.
+      const int64_t sd = d4 >> 63;
+      const int64_t se = e4 >> 63;
+      int64_t       md = (u & sd) + (v & se);
+      int64_t       me = (q & sd) + (r & se);
+
+      __int128 cd = __int128(u) * d0 + __int128(v) * e0;
+      __int128 ce = __int128(q) * d0 + __int128(r) * e0;
+
+      // Correct md and me so that the low 62 bits of the sum are zero.
+      md -= int64_t((modulus_inv62 * uint64_t(cd) + uint64_t(md)) & m62);
+      me -= int64_t((modulus_inv62 * uint64_t(ce) + uint64_t(me)) & m62);
+
+      cd += __int128(modulus.v[0]) * md;
+      ce += __int128(modulus.v[0]) * me;
+      cd >>= 62;
+      ce >>= 62;
+
+      cd += __int128(u) * d1 + __int128(v) * e1 + __int128(modulus.v[1]) * md;
+      ce += __int128(q) * d1 + __int128(r) * e1 + __int128(modulus.v[1]) * me;
+      d.v[0] = int64_t(uint64_t(cd) & m62);
+      e.v[0] = int64_t(uint64_t(ce) & m62);
+      cd >>= 62;
+      ce >>= 62;
+
+      cd += __int128(u) * d2 + __int128(v) * e2 + __int128(modulus.v[2]) * md;
+      ce += __int128(q) * d2 + __int128(r) * e2 + __int128(modulus.v[2]) * me;
+      d.v[1] = int64_t(uint64_t(cd) & m62);
+      e.v[1] = int64_t(uint64_t(ce) & m62);
+      cd >>= 62;
+      ce >>= 62;
+
+      cd += __int128(u) * d3 + __int128(v) * e3 + __int128(modulus.v[3]) * md;
+      ce += __int128(q) * d3 + __int128(r) * e3 + __int128(modulus.v[3]) * me;
+      d.v[2] = int64_t(uint64_t(cd) & m62);
+      e.v[2] = int64_t(uint64_t(ce) & m62);
+      cd >>= 62;
+      ce >>= 62;
+
+      cd += __int128(u) * d4 + __int128(v) * e4 + __int128(modulus.v[4]) * md;
+      ce += __int128(q) * d4 + __int128(r) * e4 + __int128(modulus.v[4]) * me;
+      d.v[3] = int64_t(uint64_t(cd) & m62);
+      e.v[3] = int64_t(uint64_t(ce) & m62);
+      cd >>= 62;
+      ce >>= 62;
+
+      d.v[4] = int64_t(cd);
+      e.v[4] = int64_t(ce);
+   }
+
+   // update_fg computes t·[f, g] / 2⁶², which is exact by construction of t.
+   constexpr void update_fg(signed62& f, signed62& g, const trans2x2& t) noexcept {
+      const int64_t f0 = f.v[0], f1 = f.v[1], f2 = f.v[2], f3 = f.v[3], f4 = f.v[4];
+      const int64_t g0 = g.v[0], g1 = g.v[1], g2 = g.v[2], g3 = g.v[3], g4 = g.v[4];
+      const int64_t u = t.u, v = t.v, q = t.q, r = t.r;
+
+      __int128 cf = __int128(u) * f0 + __int128(v) * g0;
+      __int128 cg = __int128(q) * f0 + __int128(r) * g0;
+      cf >>= 62;
+      cg >>= 62;
+
+      cf += __int128(u) * f1 + __int128(v) * g1;
+      cg += __int128(q) * f1 + __int128(r) * g1;
+      f.v[0] = int64_t(uint64_t(cf) & m62);
+      g.v[0] = int64_t(uint64_t(cg) & m62);
+      cf >>= 62;
+      cg >>= 62;
+
+      cf += __int128(u) * f2 + __int128(v) * g2;
+      cg += __int128(q) * f2 + __int128(r) * g2;
+      f.v[1] = int64_t(uint64_t(cf) & m62);
+      g.v[1] = int64_t(uint64_t(cg) & m62);
+      cf >>= 62;
+      cg >>= 62;
+
+      cf += __int128(u) * f3 + __int128(v) * g3;
+      cg += __int128(q) * f3 + __int128(r) * g3;
+      f.v[2] = int64_t(uint64_t(cf) & m62);
+      g.v[2] = int64_t(uint64_t(cg) & m62);
+      cf >>= 62;
+      cg >>= 62;
+
+      cf += __int128(u) * f4 + __int128(v) * g4;
+      cg += __int128(q) * f4 + __int128(r) * g4;
+      f.v[3] = int64_t(uint64_t(cf) & m62);
+      g.v[3] = int64_t(uint64_t(cg) & m62);
+      cf >>= 62;
+      cg >>= 62;
+
+      f.v[4] = int64_t(cf);
+      g.v[4] = int64_t(cg);
+   }
+
+   // normalize brings r from (-2p, p) into [0, p), negating it first if sign is
+   // negative.
+   constexpr void normalize(signed62& r, int64_t sign) noexcept {
+      int64_t r0 = r.v[0], r1 = r.v[1], r2 = r.v[2], r3 = r.v[3], r4 = r.v[4];
+
+      int64_t cond_add = r4 >> 63;
+      r0 += modulus.v[0] & cond_add;
+      r1 += modulus.v[1] & cond_add;
+      r2 += modulus.v[2] & cond_add;
+      r3 += modulus.v[3] & cond_add;
+      r4 += modulus.v[4] & cond_add;
+
+      const int64_t cond_negate = sign >> 63;
+      r0 = (r0 ^ cond_negate) - cond_negate;
+      r1 = (r1 ^ cond_negate) - cond_negate;
+      r2 = (r2 ^ cond_negate) - cond_negate;
+      r3 = (r3 ^ cond_negate) - cond_negate;
+      r4 = (r4 ^ cond_negate) - cond_negate;
+
+      r1 += r0 >> 62;
+      r0 &= m62;
+      r2 += r1 >> 62;
+      r1 &= m62;
+      r3 += r2 >> 62;
+      r2 &= m62;
+      r4 += r3 >> 62;
+      r3 &= m62;
+
+      cond_add = r4 >> 63;
+      r0 += modulus.v[0] & cond_add;
+      r1 += modulus.v[1] & cond_add;
+      r2 += modulus.v[2] & cond_add;
+      r3 += modulus.v[3] & cond_add;
+      r4 += modulus.v[4] & cond_add;
+
+      r1 += r0 >> 62;
+      r0 &= m62;
+      r2 += r1 >> 62;
+      r1 &= m62;
+      r3 += r2 >> 62;
+      r2 &= m62;
+      r4 += r3 >> 62;
+      r3 &= m62;
+
+      r = { { r0, r1, r2, r3, r4 } };
+   }
+
+} // namespace safegcd
+
+// gfp_invert returns a⁻¹ mod p for a in [0, p), or 0 if a is 0. Both the input
+// and the result are plain integers, not Montgomery encoded.
+constexpr std::array<uint64_t, 4> gfp_invert(const std::array<uint64_t, 4>& a) noexcept {
+   using namespace safegcd;
+
+   signed62 d{ { 0, 0, 0, 0, 0 } };
+   signed62 e{ { 1, 0, 0, 0, 0 } };
+   signed62 f    = modulus;
+   signed62 g    = from_u256(a);
+   int64_t  zeta = -1;
+
+   // 10 rounds of 59 divsteps are enough for inputs below 2²⁵⁶.
+   for (int i = 0; i < 10; ++i) {
+      trans2x2 t{};
+      zeta = divsteps_59(zeta, uint64_t(f.v[0]), uint64_t(g.v[0]), t);
+      update_de(d, e, t);
+      update_fg(f, g, t);
+   }
+
+   // g is now 0 and f is ±1.
+   normalize(d, f.v[4]);
+   return to_u256(d);
+}
+
+} // namespace bn256
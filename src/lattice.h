@@ -4,74 +4,197 @@
 
 namespace bn256 {
 
+// wnaf writes the width-W non-adjacent form of the non-negative k into digits,
+// least significant digit first, and returns the number of digits used. Every
+// non-zero digit is odd and smaller than 2^(W-1) in absolute value, and at most
+// one of any W consecutive digits is non-zero. digits must have room for
+// bitlen(k)+1 entries.
+template <int W>
+constexpr int wnaf(int512_t k, std::span<int8_t> digits) noexcept {
+   static_assert(W >= 2 && W <= 7);
+   constexpr int64_t window = 1 << W;
+
+   int len = 0;
+   while (k != int512_t{}) {
+      int64_t digit = 0;
+      if (bit_test(k, 0)) {
+         digit = static_cast<int64_t>(k.limbs_[0] & (window - 1));
+         if (digit >= window / 2) {
+            digit -= window;
+         }
+         k -= int512_t{ digit };
+      }
+      digits[len++] = static_cast<int8_t>(digit);
+      k >>= 1;
+   }
+   return len;
+}
+
 template <std::size_t N>
 struct lattice {
-   int512_t vectors_[N][N];
-   int512_t              inverse_[N];
-   const int512_t                     det_;
+   static constexpr int rounding_shift = 320;
+
+   int512_t       vectors_[N][N];
+   int512_t       inverse_[N];
+   const int512_t det_;
+   // rounding_[i] is round(2^rounding_shift·inverse_[i]/det_).
+   int512_t rounding_[N];
 
    // decompose takes a scalar mod order as input and finds a short,
    // positive decomposition of it wrt to the lattice basis.
-   constexpr std::array<int512_t, N> decompose(std::span<const uint64_t, 4> scalar) const noexcept{
-      int512_t              k = {scalar[0], scalar[1], scalar[2], scalar[3], 0, 0, 0, 0};
-      // int512_t              k = to_i512(scalar);
-      int512_t c[N] = {};
-
-      // Calculate closest vector in lattice to <k,0,0,...> with Babai's rounding.
+   //
+   // The closest lattice vector to <k,0,0,...> is found with Babai's rounding,
+   // c_i = round(k·inverse_[i]/det_), computed as ⌊(k·rounding_[i] + 2^(m-1))/2^m⌋
+   // with the precomputed rounding_[i] = round(2^m·inverse_[i]/det_) and
+   // m = rounding_shift. As k < 2²⁵⁶ the error is below 2⁻⁶⁴, so c_i can only
+   // differ from the exact rounding when k·inverse_[i]/det_ is that close to a
+   // half-integer, where both choices are equally good. Adding twice the first
+   // basis vector keeps the result positive.
+   //
+   // The result is short, so it is computed modulo 2¹⁹² on three words.
+   constexpr std::array<int512_t, N> decompose(std::span<const uint64_t, 4> scalar) const noexcept {
+      word3 c[N] = {};
       for (std::size_t i = 0; i < N; i++) {
-         c[i] = k * inverse_[i];
-         round(c[i], det_);
+         const int512_t g = abs(rounding_[i]);
+
+         std::array<uint64_t, 9> t{};
+         for (std::size_t a = 0; a < 4; ++a) {
+            uint64_t carry = 0;
+            for (std::size_t b = 0; b < 5; ++b) { t[a + b] = mac_u64(scalar[a], g.limbs_[b], t[a + b], carry, &carry); }
+            t[a + 5] = carry;
+         }
+
+         // Add 2^(m-1) and keep the words above 2^m.
+         bool carry = addcarry_u64(false, t[4], uint64_t(1) << 63, &t[4]);
+         for (std::size_t j = 5; j < 8; ++j) { carry = addcarry_u64(carry, t[j], 0, &t[j]); }
+         c[i] = { t[5], t[6], t[7] };
+         if (is_neg(rounding_[i])) {
+            c[i] = sub3({}, c[i]);
+         }
       }
 
       // Transform vectors according to c and subtract <k,0,0,...>.
       std::array<int512_t, N> out;
-      int512_t                temp;
       for (std::size_t i = 0; i < N; i++) {
-         out[i] = 0;
-         for (std::size_t j = 0; j < N; j++) {
-            temp = c[j] * vectors_[j][i];
-            out[i] += temp;
+         const word3 v0 = low3(vectors_[0][i]);
+         word3       o = add3(v0, v0);
+         if (i == 0) {
+            o = add3(o, { scalar[0], scalar[1], scalar[2] });
          }
-         out[i] = -out[i];
-         out[i] += vectors_[0][i];
-         out[i] += vectors_[0][i];
+         for (std::size_t j = 0; j < N; j++) { o = sub3(o, mul3(c[j], low3(vectors_[j][i]))); }
+         out[i] = int512_t{ o[0], o[1], o[2], 0 };
       }
-      out[0] += k;
       return out;
    }
 
+   // foreach_signed_multi_scalar decomposes scalar and recodes the sub-scalars
+   // k₀..k_{N-1} into sign-aligned columns (GLV-SAC, Algorithm 1 of Faz-Hernández,
+   // Longa and Sánchez, "Efficient and Secure Algorithms for GLV-Based Scalar
+   // Multiplication and their Implementation on GLV-GLS Curves"). Every digit of
+   // k₀ is ±1 and every digit of k_j is either 0 or the digit of k₀ in the same
+   // column, so each column selects one of the 2^(N-1) points P₀ + Σ b_j·P_j
+   // together with a sign. Starting at the most significant column, lambda is
+   // called with (negative, index) where bit j-1 of index is b_j; the leading
+   // column is always positive.
+   //
+   // The recoding requires k₀ to be odd. When it is even 1 is added to it and the
+   // function returns true, in which case the caller has to subtract P₀ once.
    template <typename Lambda>
-   constexpr void foreach_multi_scalar(std::span<const uint64_t, 4> scalar, Lambda&& lambda) const noexcept{
+   constexpr bool foreach_signed_multi_scalar(std::span<const uint64_t, 4> scalar, Lambda&& lambda) const noexcept {
+      static_assert(N >= 2 && N <= 8);
 
-      auto decomp = decompose(scalar);
+      auto decomp   = decompose(scalar);
+      bool adjusted = !bit_test(decomp[0], 0);
+      if (adjusted) {
+         decomp[0] += int512_t{ 1 };
+      }
 
-      int maxlen = 0;
+      int len = 0;
       for (std::size_t i = 0; i < N; ++i) {
-         maxlen = std::max(maxlen, bitlen(decomp[i]));
+         len = std::max(len, bitlen(decomp[i]));
       }
+      len += 1;
 
-      for (int i = maxlen-1; i >=0; --i) {
-         uint8_t out=0;
-         for (std::size_t j = 0; j < N; ++j) {
-            if (bit_test(decomp[j], i)) {
-               out += (1 << j);
+      std::array<bool, 512>    negative{};
+      std::array<uint8_t, 512> index{};
+      for (int i = 0; i < len - 1; ++i) {
+         negative[i] = !bit_test(decomp[0], i + 1);
+      }
+
+      for (std::size_t j = 1; j < N; ++j) {
+         for (int i = 0; i < len; ++i) {
+            bool digit = bit_test(decomp[j], 0);
+            decomp[j] >>= 1;
+            if (digit) {
+               index[i] |= (1 << (j - 1));
+               // k_j = ⌊k_j/2⌋ - ⌊b_j/2⌋ with b_j = -1 borrows one from the next column.
+               if (negative[i]) {
+                  decomp[j] += int512_t{ 1 };
+               }
             }
          }
-         lambda(out);
       }
+
+      for (int i = len - 1; i >= 0; --i) {
+         lambda(negative[i], index[i]);
+      }
+      return adjusted;
    }
 
-   // round sets num to num/denom rounded to the nearest integer.
-   constexpr void round(int512_t& num, const int512_t& denom) const noexcept {
-      if (denom != 0) {
-         const int512_t half = int512_t{constants::order[0], constants::order[1], constants::order[2], constants::order[3]}>> 1;
-         num /= denom;
-         int512_t rem            = num % denom;
-         if (rem > half) {
-            num = num + int512_t{1};
+   // foreach_wnaf_multi_scalar decomposes scalar and recodes every sub-scalar in
+   // width-W non-adjacent form. Starting at the most significant column, lambda
+   // is called with the N digits of the column; non-zero digits are odd, so
+   // callers only need tables of the odd multiples of each base.
+   template <int W, typename Lambda>
+   constexpr void foreach_wnaf_multi_scalar(std::span<const uint64_t, 4> scalar, Lambda&& lambda) const noexcept {
+      auto decomp = decompose(scalar);
+
+      std::array<std::array<int8_t, 512>, N> digits{};
+      int                                    maxlen = 0;
+      for (std::size_t j = 0; j < N; ++j) {
+         maxlen = std::max(maxlen, wnaf<W>(decomp[j], digits[j]));
+      }
+
+      for (int i = maxlen - 1; i >= 0; --i) {
+         std::array<int8_t, N> column;
+         for (std::size_t j = 0; j < N; ++j) {
+            column[j] = digits[j][i];
          }
+         lambda(column);
       }
    }
+
+   using word3 = std::array<uint64_t, 3>;
+
+   static constexpr word3 low3(const int512_t& a) noexcept { return { a.limbs_[0], a.limbs_[1], a.limbs_[2] }; }
+
+   static constexpr word3 add3(const word3& a, const word3& b) noexcept {
+      word3 c{};
+      bool  carry = addcarry_u64(false, a[0], b[0], &c[0]);
+      carry       = addcarry_u64(carry, a[1], b[1], &c[1]);
+      addcarry_u64(carry, a[2], b[2], &c[2]);
+      return c;
+   }
+
+   static constexpr word3 sub3(const word3& a, const word3& b) noexcept {
+      word3 c{};
+      bool  borrow = subborrow_u64(false, a[0], b[0], &c[0]);
+      borrow       = subborrow_u64(borrow, a[1], b[1], &c[1]);
+      subborrow_u64(borrow, a[2], b[2], &c[2]);
+      return c;
+   }
+
+   // mul3 returns a·b mod 2¹⁹².
+   static constexpr word3 mul3(const word3& a, const word3& b) noexcept {
+      uint64_t hi = 0;
+      word3    c{};
+      c[0] = mac_u64(a[0], b[0], 0, 0, &hi);
+      c[1] = mac_u64(a[0], b[1], hi, 0, &hi);
+      c[2] = a[0] * b[2] + hi;
+      c[1] = mac_u64(a[1], b[0], c[1], 0, &hi);
+      c[2] += hi + a[1] * b[1] + a[2] * b[0];
+      return c;
+   }
 };
 
 static const lattice<2> curve_lattice = {
@@ -88,7 +211,11 @@ static const lattice<2> curve_lattice = {
          147946756881789318990833708069417712965_i512,
          147946756881789319010696353538189108491_i512,
       },
-      .det_ = 43776485743678550444492811490514550177096728800832068687396408373151616991234_i512
+      .det_ = 43776485743678550444492811490514550177096728800832068687396408373151616991234_i512,
+      .rounding_ = {
+         7218769376700772731708801789669128451608274202474654981107_i512,
+         7218769376700772732677960288795920402036671683500379884262_i512,
+      }
    };
 
 static const lattice<4> target_lattice = {
@@ -104,7 +231,11 @@ static const lattice<4> target_lattice = {
                  147946756881789319000765030803803410728_i512,
                  -147946756881789319005730692170996259609_i512,
                  1469306990098747947464455738335385361643788813749140841702_i512 },
-   .det_     = 0x30644E72E131A029B85045B68181585D2833E84879B9709143E1F593F0000001_i512
+   .det_     = 0x30644E72E131A029B85045B68181585D2833E84879B9709143E1F593F0000001_i512,
+   .rounding_ = { 71691928425115657338774528867931613015400450013818096733255888418560393973286_i512,
+                  14437538753401545464386762078465048853644945885975034865370_i512,
+                  -14437538753401545464871341328028444828810351604397736671509_i512,
+                  143383856850231314691986596489264771496641399854791430245750525922544249521237_i512 }
 };
 
 } // namespace bn256
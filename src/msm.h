@@ -0,0 +1,189 @@
+#pragma once
+#include "gfp2.h"
+#include <algorithm>
+#include <array>
+#include <span>
+#include <thread>
+#include <vector>
+
+namespace bn256 {
+
+namespace pippenger {
+
+   // digit_count returns the number of signed window-bit digits of a 256-bit
+   // scalar, which needs one more bit for the carry of the top digit.
+   constexpr std::size_t digit_count(std::size_t window) noexcept { return (256 + window) / window; }
+
+   // window_size picks the window minimizing the estimated number of additions
+   // for n points: every window costs n mixed additions to fill the buckets and
+   // two general additions, about 1.5 mixed ones each, per bucket to sum them.
+   // Windows are capped at 15 bits so that the digits fit in an int16_t.
+   constexpr std::size_t window_size(std::size_t n) noexcept {
+      std::size_t best      = 2;
+      double      best_cost = 0;
+      for (std::size_t window = 2; window <= 15; ++window) {
+         const double buckets = double(std::size_t(1) << (window - 1));
+         const double cost    = double(digit_count(window)) * (double(n) + 3 * buckets);
+         if (window == 2 || cost < best_cost) {
+            best      = window;
+            best_cost = cost;
+         }
+      }
+      return best;
+   }
+
+   // recode writes the signed window-bit digits of scalar into digits, least
+   // significant first, with |dᵢ| ≤ 2^(window-1), see fixed_base_table::mul.
+   inline void recode(std::span<const uint64_t, 4> scalar, std::size_t window, std::span<int16_t> digits) noexcept {
+      const uint64_t mask    = (uint64_t(1) << window) - 1;
+      const uint64_t entries = uint64_t(1) << (window - 1);
+
+      uint64_t carry = 0;
+      for (std::size_t i = 0; i < digits.size(); ++i) {
+         const std::size_t bit   = window * i;
+         const std::size_t word  = bit / 64;
+         const std::size_t shift = bit % 64;
+
+         uint64_t digit = 0;
+         if (word < 4) {
+            digit = scalar[word] >> shift;
+            if (shift + window > 64 && word + 1 < 4) {
+               digit |= scalar[word + 1] << (64 - shift);
+            }
+         }
+         digit = (digit & mask) + carry;
+
+         carry     = digit > entries;
+         digits[i] = static_cast<int16_t>(carry ? int64_t(digit) - int64_t(mask + 1) : int64_t(digit));
+      }
+   }
+
+   // parallel_for calls fun(i, worker) for every i in [0, n), spreading the
+   // calls over up to workers threads. worker < workers identifies the thread,
+   // so that fun can use preallocated per-thread scratch space; fun must not
+   // throw. When a thread cannot be started, its share of the calls runs on the
+   // calling thread instead.
+   template <typename Fun>
+   void parallel_for(std::size_t n, std::size_t workers, Fun&& fun) {
+      workers = std::min(workers, n);
+      if (workers == 0) {
+         return;
+      }
+      auto run = [&fun, n, workers](std::size_t worker) {
+         for (std::size_t i = worker; i < n; i += workers) { fun(i, worker); }
+      };
+
+      std::vector<std::thread> pool;
+      std::size_t              started = 1;
+      try {
+         pool.reserve(workers - 1);
+         for (; started < workers; ++started) { pool.emplace_back(run, started); }
+      } catch (...) {
+         // std::system_error or std::bad_alloc, handled by the loop below.
+      }
+
+      run(0);
+      for (std::size_t worker = started; worker < workers; ++worker) { run(worker); }
+      for (auto& t : pool) { t.join(); }
+   }
+
+} // namespace pippenger
+
+// multi_scalar_mult returns Σ scalars[i]·points[i] with Pippenger's bucket
+// method. Every scalar is recoded into signed digits of w bits, w chosen from
+// the number of points, and for each digit position the points are accumulated
+// into 2^(w-1) buckets by the absolute value of their digit, which are then
+// summed with running sums; the per-position sums are combined with w doublings
+// each. Points are normalized first so that filling the buckets only takes
+// mixed additions.
+//
+// With threads > 1 the bucket accumulation is split into tasks of one digit
+// position and one slice of the points, which are spread over the threads.
+// Digit positions are independent, so the points are only sliced when there are
+// more threads than positions. The number of threads is capped by the number of
+// tasks; callers should also cap it by the number of cores. All memory is
+// allocated up front on the calling thread, so std::bad_alloc is thrown from
+// there.
+template <typename Point>
+Point multi_scalar_mult(std::span<const Point> points, std::span<const std::array<uint64_t, 4>> scalars,
+                        unsigned threads = 1) {
+   using affine = typename Point::affine;
+   using field  = decltype(Point{}.z_);
+
+   const std::size_t n = std::min(points.size(), scalars.size());
+   if (n == 0) {
+      return Point::infinity();
+   }
+
+   const std::size_t window  = pippenger::window_size(n);
+   const std::size_t digits  = pippenger::digit_count(window);
+   const std::size_t buckets = std::size_t(1) << (window - 1);
+   const std::size_t slices  = std::min<std::size_t>((std::max(threads, 1u) + digits - 1) / digits, n);
+   const std::size_t slice   = (n + slices - 1) / slices;
+   const std::size_t tasks   = digits * slices;
+   const std::size_t workers = std::min<std::size_t>(std::max(threads, 1u), tasks);
+
+   // Normalize and recode the points in one chunk per thread. Points at
+   // infinity get all-zero digits.
+   std::vector<affine>  normalized(n);
+   std::vector<int16_t> recoded(n * digits);
+   std::vector<field>   z_inv(n), scratch(n);
+   const std::size_t    chunks = std::min(workers, n);
+   pippenger::parallel_for(chunks, workers, [&](std::size_t c, std::size_t) {
+      const std::size_t begin = n * c / chunks;
+      const std::size_t end   = n * (c + 1) / chunks;
+
+      for (std::size_t i = begin; i < end; ++i) { z_inv[i] = points[i].z_; }
+      batch_invert(std::span<field>(z_inv).subspan(begin, end - begin),
+                   std::span<field>(scratch).subspan(begin, end - begin));
+
+      for (std::size_t i = begin; i < end; ++i) {
+         std::span<int16_t> d{ recoded.data() + i * digits, digits };
+         if (points[i].is_infinity()) {
+            std::fill(d.begin(), d.end(), 0);
+            continue;
+         }
+         normalized[i] = points[i].to_affine(z_inv[i]);
+         pippenger::recode(scalars[i], window, d);
+      }
+   });
+
+   // Task t covers digit position t / slices and slice t % slices. Every
+   // thread has its own buckets.
+   std::vector<Point> partial(tasks);
+   std::vector<Point> bucket_storage(workers * buckets);
+   pippenger::parallel_for(tasks, workers, [&](std::size_t t, std::size_t worker) {
+      const std::size_t position = t / slices;
+      const std::size_t begin    = (t % slices) * slice;
+      const std::size_t end      = std::min(n, begin + slice);
+
+      std::span<Point> bucket{ bucket_storage.data() + worker * buckets, buckets };
+      std::fill(bucket.begin(), bucket.end(), Point::infinity());
+      for (std::size_t i = begin; i < end; ++i) {
+         const int16_t digit = recoded[i * digits + position];
+         if (digit > 0) {
+            bucket[digit - 1] = bucket[digit - 1].add_mixed(normalized[i]);
+         } else if (digit < 0) {
+            bucket[-digit - 1] = bucket[-digit - 1].add_mixed(normalized[i].neg());
+         }
+      }
+
+      // Σ (j+1)·bucket[j] as a sum of the running sums from the top bucket down.
+      Point running = Point::infinity();
+      Point sum     = Point::infinity();
+      for (std::size_t j = buckets; j-- > 0;) {
+         running = running.add(bucket[j]);
+         sum     = sum.add(running);
+      }
+      partial[t] = sum;
+   });
+
+   Point sum = Point::infinity();
+   for (std::size_t position = digits; position-- > 0;) {
+      for (std::size_t i = 0; i < window; ++i) { sum = sum.double_(); }
+      for (std::size_t s = 0; s < slices; ++s) { sum = sum.add(partial[position * slices + s]); }
+   }
+   return sum;
+}
+
+} // namespace bn256
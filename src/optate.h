@@ -3,10 +3,20 @@
 #include "twist.h"
 #include "gfp6.h"
 #include "gfp12.h"
+#include <span>
+#include <vector>
 
 namespace bn256 {
 
-constexpr auto line_function_add(const twist_point& r, const twist_point& p, const curve_point& q, const gfp2& r2) noexcept {
+// line_coeffs holds the coefficients of a line function as computed from the
+// G₂ point alone. The line evaluated at a G₁ point q is (aτ + b·q.x)ω + c·q.y.
+struct line_coeffs {
+   gfp2 a;
+   gfp2 b;
+   gfp2 c;
+};
+
+constexpr auto line_function_add(const twist_point& r, const twist_point& p, const gfp2& r2) noexcept {
    // See the mixed addition algorithm from "Faster Computation of the
    // Tate Pairing", http://arxiv.org/pdf/0904.0854v3.pdf
    gfp2 B = p.x_.mul(r.t_);
@@ -49,18 +59,16 @@ constexpr auto line_function_add(const twist_point& r, const twist_point& p, con
    t2     = t2.add(t2);
    gfp2 a = t2.sub(t);
 
-   gfp2 c = rOut.z_.mul_scalar(q.y_);
-   c      = c.add(c);
+   gfp2 c = rOut.z_.add(rOut.z_);
 
    gfp2 b{};
    b = b.sub(L1);
-   b = b.mul_scalar(q.x_);
    b = b.add(b);
 
-   return std::make_tuple(a, b, c, rOut);
+   return std::make_tuple(line_coeffs{ a, b, c }, rOut);
 }
 
-constexpr auto line_function_double(const twist_point& r, const curve_point& q) noexcept {
+constexpr auto line_function_double(const twist_point& r) noexcept {
 
    // See the doubling algorithm for a=0 from "Faster Computation of the
    // Tate Pairing", http://arxiv.org/pdf/0904.0854v3.pdf
@@ -102,7 +110,6 @@ constexpr auto line_function_double(const twist_point& r, const curve_point& q)
    t      = t.add(t);
    gfp2 b = {};
    b      = b.sub(t);
-   b      = b.mul_scalar(q.x_);
 
    gfp2 a = r.x_.add(E);
    a      = a.square();
@@ -114,28 +121,61 @@ constexpr auto line_function_double(const twist_point& r, const curve_point& q)
 
    gfp2 c = rOut.z_.mul(r.t_);
    c      = c.add(c);
-   c      = c.mul_scalar(q.y_);
 
-   return std::make_tuple(a, b, c, rOut);
+   return std::make_tuple(line_coeffs{ a, b, c }, rOut);
 }
 
-constexpr void mul_line(gfp12& ret, const gfp2& a, const gfp2& b, const gfp2& c) {
-
-   gfp6 a2{ gfp2::zero(), a, b };
-   a2      = a2.mul(ret.x_);
-   gfp6 t3 = ret.y_.mul_scalar(c);
+// mul_line multiplies ret by the line evaluated at q. The line
+// (aτ + b·q.x)ω + c·q.y has only three non-zero GF(p²) coefficients, so the
+// Karatsuba product needs 13 GF(p²) multiplications, 5 for each
+// gfp6::mul_sparse and 3 for mul_scalar, instead of 15 with dense gfp6::mul.
+constexpr void mul_line(gfp12& ret, const line_coeffs& line, const curve_point& q) {
+   const gfp2& a = line.a;
+   gfp2        b = line.b.mul_scalar(q.x_);
+   gfp2        c = line.c.mul_scalar(q.y_);
+
+   gfp6 xl = ret.x_.mul_sparse(a, b);
+   gfp6 yc = ret.y_.mul_scalar(c);
+   gfp6 t  = ret.x_.add(ret.y_).mul_sparse(a, b.add(c));
+
+   ret.x_ = t.sub(xl).sub(yc);
+   ret.y_ = yc.add(xl.mul_tau());
+}
 
-   gfp2 t = b.add(c);
-   gfp6 t2{ gfp2::zero(), a, t };
-   ret.x_ = ret.x_.add(ret.y_);
+// mul_lines multiplies two lines evaluated at the same q. With
+// Lᵢ = (aᵢτ + bᵢ)ω + cᵢ and ω² = τ the product is
+//
+//   (a₁c₂ + a₂c₁)τω + (b₁c₂ + b₂c₁)ω + (a₁b₂ + a₂b₁)τ² + b₁b₂τ + c₁c₂ + ξa₁a₂
+//
+// whose τ²ω coefficient is zero. It takes 6 GF(p²) multiplications.
+constexpr gfp12 mul_lines(const line_coeffs& line1, const line_coeffs& line2, const curve_point& q) {
+   const gfp2& a1 = line1.a;
+   gfp2        b1 = line1.b.mul_scalar(q.x_);
+   gfp2        c1 = line1.c.mul_scalar(q.y_);
+   const gfp2& a2 = line2.a;
+   gfp2        b2 = line2.b.mul_scalar(q.x_);
+   gfp2        c2 = line2.c.mul_scalar(q.y_);
+
+   gfp2 aa = a1.mul(a2);
+   gfp2 bb = b1.mul(b2);
+   gfp2 cc = c1.mul(c2);
+   gfp2 ab = a1.add(b1).mul(a2.add(b2)).sub(aa).sub(bb);
+   gfp2 ac = a1.add(c1).mul(a2.add(c2)).sub(aa).sub(cc);
+   gfp2 bc = b1.add(c1).mul(b2.add(c2)).sub(bb).sub(cc);
+
+   return { { gfp2::zero(), ac, bc }, { ab, bb, cc.add(aa.mul_xi()) } };
+}
 
-   ret.y_ = t3;
+// mul_line_pair multiplies ret by the output of mul_lines, using its zero
+// coefficient to save one GF(p²) multiplication: 17 in total, so together with
+// mul_lines two lines cost 23 instead of the 26 of two mul_line calls.
+constexpr void mul_line_pair(gfp12& ret, const gfp12& lines) {
+   gfp6 xl = ret.x_.mul_sparse(lines.x_.y_, lines.x_.z_);
+   gfp6 yl = ret.y_.mul(lines.y_);
+   gfp6 t  = ret.x_.add(ret.y_).mul(lines.x_.add(lines.y_));
 
-   ret.x_ = ret.x_.mul(t2);
-   ret.x_ = ret.x_.sub(a2);
-   ret.x_ = ret.x_.sub(ret.y_);
-   a2     = a2.mul_tau();
-   ret.y_ = ret.y_.add(a2);
+   ret.x_ = t.sub(xl).sub(yl);
+   ret.y_ = yl.add(xl.mul_tau());
 }
 
 // sixuPlus2NAF is 6u+2 in non-adjacent form.
@@ -144,37 +184,41 @@ constexpr std::array<int8_t, 65> six_u_plus_2_naf = {
    0,  1, 0, -1, 0, 0, 0, 0,  1, 1, 1, 0,  0, -1, 0,  0, 1, 0, 0, 0, 0,  0,
    -1, 0, 0, 1,  1, 0, 0, -1, 0, 0, 0, 1,  1, 0,  -1, 0, 0, 1, 0, 1, 1 };
 
-// miller implements the Miller loop for calculating the Optimal Ate pairing.
-// See algorithm 1 from http://cryptojedi.org/papers/dclxvi-20100714.pdf
-inline gfp12 miller(const twist_point& q, const curve_point& p) noexcept {
-   gfp12 ret = gfp12::one();
-
-   twist_point a_affine = q.make_affine();
-   curve_point b_affine = p.make_affine();
+// miller_line_count is the number of lines the Miller loop multiplies into the
+// accumulator: one doubling per iteration, one addition per non-zero NAF digit
+// and the two additions of the Frobenius images of Q.
+constexpr std::size_t miller_line_count() noexcept {
+   std::size_t count = 2;
+   for (auto i = six_u_plus_2_naf.size() - 1; i > 0; i--) {
+      count += (six_u_plus_2_naf[i - 1] != 0) ? 2 : 1;
+   }
+   return count;
+}
 
-   twist_point minus_a = a_affine.neg();
+// prepared_twist caches the line coefficients of the Miller loop for a fixed
+// point of G₂, so that pairings against it only need the line evaluations and
+// the GF(p¹²) arithmetic.
+struct prepared_twist {
+   std::array<line_coeffs, miller_line_count()> lines;
+};
 
-   twist_point r = a_affine;
+inline prepared_twist prepare_twist(const twist_point& q) noexcept {
+   prepared_twist prepared{};
+   auto           out = prepared.lines.begin();
 
-   gfp2 r2 = a_affine.y_.square();
+   twist_point a_affine = q.make_affine();
+   twist_point minus_a  = a_affine.neg();
+   twist_point r        = a_affine;
+   gfp2        r2       = a_affine.y_.square();
 
    for (auto i = six_u_plus_2_naf.size() - 1; i > 0; i--) {
-      auto [a, b, c, newR] = line_function_double(r, b_affine);
-      if (i != six_u_plus_2_naf.size() - 1) {
-         ret = ret.square();
-      }
-
-      mul_line(ret, a, b, c);
-      r = newR;
+      std::tie(*out++, r) = line_function_double(r);
 
       switch (six_u_plus_2_naf[i - 1]) {
-         case 1: std::tie(a, b, c, newR) = line_function_add(r, a_affine, b_affine, r2); break;
-         case -1: std::tie(a, b, c, newR) = line_function_add(r, minus_a, b_affine, r2); break;
-         default: continue;
+         case 1: std::tie(*out++, r) = line_function_add(r, a_affine, r2); break;
+         case -1: std::tie(*out++, r) = line_function_add(r, minus_a, r2); break;
+         default: break;
       }
-
-      mul_line(ret, a, b, c);
-      r = newR;
    }
 
    // In order to calculate Q1 we have to convert q from the sextic twist
@@ -213,23 +257,110 @@ inline gfp12 miller(const twist_point& q, const curve_point& p) noexcept {
    minus_q2.z_.set_one();
    minus_q2.t_.set_one();
 
-   r2                   = q1.y_.square();
-   auto [a, b, c, newR] = line_function_add(r, q1, b_affine, r2);
-   mul_line(ret, a, b, c);
-   r = newR;
+   r2                  = q1.y_.square();
+   std::tie(*out++, r) = line_function_add(r, q1, r2);
 
-   r2                      = minus_q2.y_.square();
-   std::tie(a, b, c, newR) = line_function_add(r, minus_q2, b_affine, r2);
-   mul_line(ret, a, b, c);
-   r = newR;
+   r2                  = minus_q2.y_.square();
+   std::tie(*out++, r) = line_function_add(r, minus_q2, r2);
+
+   return prepared;
+}
+
+// no_yield is the default yield callback of miller_loop and multi_miller.
+struct no_yield {
+   constexpr void operator()() const noexcept {}
+};
+
+// miller_loop implements the Miller loop for the product of the Optimal Ate
+// pairings of qs[i] and ps[i], where every ps[i] is in affine form. See
+// algorithm 1 from http://cryptojedi.org/papers/dclxvi-20100714.pdf
+//
+// All pairs are stepped through the loop together, so the accumulator is
+// squared once per iteration no matter how many pairs there are. The result
+// equals the product of miller(qs[i], ps[i]).
+//
+// yield is called after every iteration of the loop and after every
+// yield_interval pairs within an iteration, so the work between two calls never
+// exceeds the Miller loop of a single pair.
+template <typename Yield = no_yield>
+inline gfp12 miller_loop(std::span<const prepared_twist* const> qs, std::span<const curve_point> affine_ps,
+                         Yield&& yield = Yield{}) {
+   constexpr std::size_t yield_interval = 64;
+
+   gfp12       ret  = gfp12::one();
+   std::size_t line = 0;
+
+   for (auto i = six_u_plus_2_naf.size() - 1; i > 0; i--) {
+      if (i != six_u_plus_2_naf.size() - 1) {
+         ret = ret.square();
+      }
+
+      // The doubling and addition lines of an iteration are multiplied
+      // together first, which is cheaper than two sparse products with ret.
+      const bool has_add = six_u_plus_2_naf[i - 1] != 0;
+      for (auto j = 0U; j < qs.size(); ++j) {
+         if (has_add) {
+            mul_line_pair(ret, mul_lines(qs[j]->lines[line], qs[j]->lines[line + 1], affine_ps[j]));
+         } else {
+            mul_line(ret, qs[j]->lines[line], affine_ps[j]);
+         }
+         if ((j + 1) % yield_interval == 0) {
+            yield();
+         }
+      }
+      line += has_add ? 2 : 1;
+      yield();
+   }
+
+   // The lines of Q1 and -Q2.
+   for (auto j = 0U; j < qs.size(); ++j) {
+      mul_line_pair(ret, mul_lines(qs[j]->lines[line], qs[j]->lines[line + 1], affine_ps[j]));
+   }
 
    return ret;
 }
 
-// finalExponentiation computes the (p¹²-1)/Order-th power of an element of
-// GF(p¹²) to obtain an element of GT (steps 13-15 of algorithm 1 from
-// http://cryptojedi.org/papers/dclxvi-20100714.pdf)
-inline gfp12 final_exponentiation(const gfp12& in) noexcept {
+// multi_miller runs miller_loop on prepared twist points, normalizing ps with
+// a single inversion.
+template <typename Yield = no_yield>
+inline gfp12 multi_miller(std::span<const prepared_twist* const> qs, std::span<const curve_point> ps,
+                          Yield&& yield = Yield{}) {
+   std::vector<curve_point> affine_ps(ps.begin(), ps.end());
+   batch_make_affine(affine_ps);
+   return miller_loop(qs, affine_ps, yield);
+}
+
+// multi_miller prepares every qs[i] and then runs the Miller loop above; yield
+// is also called after each preparation.
+template <typename Yield = no_yield>
+inline gfp12 multi_miller(std::span<const twist_point> qs, std::span<const curve_point> ps,
+                          Yield&& yield = Yield{}) {
+   std::vector<prepared_twist>        prepared;
+   std::vector<const prepared_twist*> pointers;
+   prepared.reserve(qs.size());
+   for (const auto& q : qs) {
+      prepared.push_back(prepare_twist(q));
+      pointers.push_back(&prepared.back());
+      yield();
+   }
+   return multi_miller(std::span<const prepared_twist* const>(pointers), ps, yield);
+}
+
+// miller implements the Miller loop for a single pair against a prepared twist
+// point, without any heap allocation.
+inline gfp12 miller(const prepared_twist& q, const curve_point& p) noexcept {
+   const prepared_twist* pointer  = &q;
+   const curve_point     affine_p = p.make_affine();
+   return miller_loop(std::span(&pointer, 1), std::span(&affine_p, 1));
+}
+
+// miller implements the Miller loop for calculating the Optimal Ate pairing.
+// The prepared twist point lives on the stack.
+inline gfp12 miller(const twist_point& q, const curve_point& p) noexcept { return miller(prepare_twist(q), p); }
+
+// final_exponentiation_easy_part computes in^((p⁶-1)(p²+1)), which maps in
+// into the cyclotomic subgroup.
+inline gfp12 final_exponentiation_easy_part(const gfp12& in) noexcept {
    gfp12 t1{};
 
    // This is the p^6-Frobenius
@@ -240,15 +371,22 @@ inline gfp12 final_exponentiation(const gfp12& in) noexcept {
    t1        = t1.mul(inv);
 
    gfp12 t2 = t1.frobenius_p2();
-   t1       = t1.mul(t2);
+   return t1.mul(t2);
+}
+
+// finalExponentiation computes the (p¹²-1)/Order-th power of an element of
+// GF(p¹²) to obtain an element of GT (steps 13-15 of algorithm 1 from
+// http://cryptojedi.org/papers/dclxvi-20100714.pdf)
+inline gfp12 final_exponentiation(const gfp12& in) noexcept {
+   gfp12 t1 = final_exponentiation_easy_part(in);
 
    gfp12 fp  = t1.frobenius();
    gfp12 fp2 = t1.frobenius_p2();
    gfp12 fp3 = fp2.frobenius();
 
-   gfp12 fu  = t1.exp(constants::u);
-   gfp12 fu2 = fu.exp(constants::u);
-   gfp12 fu3 = fu2.exp(constants::u);
+   gfp12 fu  = t1.cyclotomic_exp(constants::u);
+   gfp12 fu2 = fu.cyclotomic_exp(constants::u);
+   gfp12 fu3 = fu2.cyclotomic_exp(constants::u);
 
    gfp12 y3   = fu.frobenius();
    gfp12 fu2p = fu2.frobenius();
@@ -267,23 +405,57 @@ inline gfp12 final_exponentiation(const gfp12& in) noexcept {
    gfp12 y6 = fu3.mul(fu3p);
    y6       = y6.conjugate();
 
-   gfp12 t0 = y6.square();
+   gfp12 t0 = y6.cyclotomic_square();
    t0       = t0.mul(y4);
    t0       = t0.mul(y5);
    t1       = y3.mul(y5);
    t1       = t1.mul(t0);
    t0       = t0.mul(y2);
-   t1       = t1.square();
+   t1       = t1.cyclotomic_square();
    t1       = t1.mul(t0);
-   t1       = t1.square();
+   t1       = t1.cyclotomic_square();
    t0       = t1.mul(y1);
    t1       = t1.mul(y0);
-   t0       = t0.square();
+   t0       = t0.cyclotomic_square();
    t0       = t0.mul(t1);
 
    return t0;
 }
 
+// fast_final_exponentiation computes final_exponentiation(in)^m with
+// m = 2u(6u²+3u+1), following "Faster hashing to G2", Fuentes-Castañeda, Knapp
+// and Rodríguez-Henríquez, section 5.2:
+//
+//   in^((p¹²-1)/Order · m) = t^(p³(12u³+6u²+4u-1) + p²(12u³+6u²+6u) +
+//                              p(12u³+6u²+4u) + (12u³+12u²+6u+1))
+//
+// where t is the output of the easy part. The chain needs fewer
+// multiplications and Frobenius maps than final_exponentiation. m is coprime
+// to Order, so the result is one exactly when final_exponentiation(in) is,
+// which is all pairing_check needs; it must not be used to compute pairings.
+inline gfp12 fast_final_exponentiation(const gfp12& in) noexcept {
+   gfp12 t = final_exponentiation_easy_part(in);
+
+   gfp12 y0 = t.cyclotomic_exp(constants::u).conjugate(); // t^-u
+   gfp12 y1 = y0.cyclotomic_square();
+   gfp12 y2 = y1.cyclotomic_square();
+   gfp12 y3 = y2.mul(y1);
+   gfp12 y4 = y3.cyclotomic_exp(constants::u).conjugate();
+   gfp12 y5 = y4.cyclotomic_square();
+   gfp12 y6 = y5.cyclotomic_exp(constants::u); // y5^u = (y5^-u)^-1
+   y3       = y3.conjugate();
+
+   gfp12 y7  = y6.mul(y4);
+   gfp12 y8  = y7.mul(y3);
+   gfp12 y9  = y8.mul(y1);
+   gfp12 y10 = y8.mul(y4);
+   gfp12 y11 = y10.mul(t);
+   gfp12 y13 = y9.frobenius().mul(y11);
+   gfp12 y14 = y8.frobenius_p2().mul(y13);
+   gfp12 y15 = t.conjugate().mul(y9);
+   return y15.frobenius_p2().frobenius().mul(y14);
+}
+
 inline gfp12 optimal_ate(const twist_point& a, const curve_point& b) noexcept {
    auto e   = miller(a, b);
    auto ret = final_exponentiation(e);
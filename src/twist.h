@@ -2,13 +2,25 @@
 
 #include "gfp2.h"
 #include "constants.h"
+#include "lattice.h"
 
 namespace bn256 {
 
+// twist_affine is a finite point of the twist in affine coordinates, the form
+// in which precomputed tables are added with twist_point::add_mixed.
+struct twist_affine {
+   gfp2 x_;
+   gfp2 y_;
+
+   constexpr twist_affine neg() const noexcept { return { x_, y_.neg() }; }
+};
+
 // twistPoint implements the elliptic curve y²=x³+3/ξ over GF(p²). Points are
 // kept in Jacobian form and t=z² when valid. The group G₂ is the set of
 // n-torsion points of this curve over GF(p²) (where n = Order)
 struct twist_point {
+   using affine = twist_affine;
+
    gfp2 x_;
    gfp2 y_;
    gfp2 z_;
@@ -18,6 +30,10 @@ struct twist_point {
       return { gfp2::zero(), gfp2::one(), gfp2::zero(), gfp2::zero() };
    }
 
+   static constexpr twist_point from_affine(const twist_affine& a) noexcept {
+      return { a.x_, a.y_, gfp2::one(), gfp2::one() };
+   }
+
    [[nodiscard]] constexpr bool is_infinity() const noexcept { return z_ == gfp2::zero(); }
 #if defined (__clang__)
 #pragma clang diagnostic push
@@ -58,8 +74,38 @@ struct twist_point {
       if (y2 != x3)
          return false;
 
-      twist_point cneg = c.mul(constants::order);
-      return cneg.z_.is_zero();
+      return c.is_in_subgroup();
+   }
+
+   // psi applies the endomorphism ψ = twist ∘ Frobenius ∘ untwist. On G₂ it acts
+   // as multiplication by p.
+   constexpr twist_point psi() const noexcept {
+      const twist_point& a = *this;
+      twist_point        c = {};
+      c.x_                 = a.x_.conjugate().mul(constants::xi_to_p_minus_1_over_3);
+      c.y_                 = a.y_.conjugate().mul(constants::xi_to_p_minus_1_over_2);
+      c.z_                 = a.z_.conjugate();
+      c.t_                 = a.t_.conjugate();
+      return c;
+   }
+
+   // is_in_subgroup reports whether a point of the twist lies in G₂. ψ acts on
+   // G₂ as multiplication by p ≡ 6u² (mod Order), so every point Q of G₂
+   // satisfies [u+1]Q + ψ([u]Q) + ψ²([u]Q) = ψ³([2u]Q). On every prime order
+   // subgroup of the cofactor 2p-Order the two sides differ, which makes this
+   // an exact membership test that only needs one multiplication by u.
+   constexpr bool is_in_subgroup() const noexcept {
+      const twist_point& q = *this;
+
+      twist_point uq  = q.mul(constants::u);
+      twist_point lhs = uq.add(q);
+      twist_point t   = uq.psi();
+      lhs             = lhs.add(t);
+      t               = t.psi();
+      lhs             = lhs.add(t);
+
+      twist_point rhs = uq.double_().psi().psi().psi();
+      return lhs.add(rhs.neg()).is_infinity();
    }
 
    constexpr twist_point add(const twist_point& b) const noexcept {
@@ -123,6 +169,58 @@ struct twist_point {
       return c;
    }
 
+   // add_mixed returns a+b for an affine b, see curve_point::add_mixed.
+   constexpr twist_point add_mixed(const twist_affine& b) const noexcept {
+      const twist_point& a = *this;
+
+      if (a.is_infinity()) {
+         return from_affine(b);
+      }
+
+      // See http://hyperelliptic.org/EFD/g1p/auto-code/shortw/jacobian-0/addition/madd-2007-bl.op3
+      gfp2 z12 = a.z_.square();
+      gfp2 u2  = b.x_.mul(z12);
+      gfp2 t   = a.z_.mul(z12);
+      gfp2 s2  = b.y_.mul(t);
+
+      gfp2 h       = u2.sub(a.x_);
+      bool x_equal = h.is_zero();
+
+      gfp2 hh = h.square();
+      gfp2 i  = hh.add(hh);
+      i       = i.add(i);
+      gfp2 j  = h.mul(i);
+
+      t            = s2.sub(a.y_);
+      bool y_equal = t.is_zero();
+      if (x_equal && y_equal) {
+         return a.double_();
+      }
+      gfp2 r = t.add(t);
+
+      gfp2 v = a.x_.mul(i);
+
+      twist_point c{};
+
+      gfp2 t4 = r.square();
+      t       = v.add(v);
+      gfp2 t6 = t4.sub(j);
+      c.x_    = t6.sub(t);
+
+      t    = v.sub(c.x_);
+      t4   = a.y_.mul(j);
+      t6   = t4.add(t4);
+      t4   = r.mul(t);
+      c.y_ = t4.sub(t6);
+
+      t    = a.z_.add(h);
+      t4   = t.square();
+      t    = t4.sub(z12);
+      c.z_ = t.sub(hh);
+      c.t_ = {};
+      return c;
+   }
+
    constexpr twist_point double_() const noexcept {
       const twist_point& a = *this;
 
@@ -161,10 +259,14 @@ struct twist_point {
       const twist_point& a = *this;
       twist_point        sum{}, t{};
 
+      // Freshly unmarshaled points are affine and can use mixed additions.
+      const bool         is_affine = a.z_.is_one();
+      const twist_affine b{ a.x_, a.y_ };
+
       for (int i = bitlen(scalar); i >= 0; i--) {
          t = sum.double_();
          if (bit_test(scalar, i)) {
-            sum = t.add(a);
+            sum = is_affine ? t.add_mixed(b) : t.add(a);
          } else {
             sum = t;
          }
@@ -173,6 +275,52 @@ struct twist_point {
       return sum;
    }
 
+   // gls_mul computes scalar·a for a point a of G₂ with the 4-dimensional GLS
+   // method. target_lattice splits scalar into k₀ + k₁·p⁵ + k₂·p¹⁰ + k₃·p³ with
+   // sub-scalars of about 66 bits, and since ψ acts on G₂ as multiplication by p
+   // the bases are a, ψ⁵(a), ψ¹⁰(a) and ψ³(a). The sign-aligned recoding makes
+   // every step one doubling and one addition of ±table[index]. Only valid for
+   // points of G₂; use mul for arbitrary points of the twist.
+   constexpr twist_point gls_mul(std::span<const uint64_t, 4> scalar) const noexcept {
+      const twist_point& a = *this;
+      if (a.is_infinity()) {
+         return a;
+      }
+
+      twist_point psi3  = a.psi().psi().psi();
+      twist_point psi5  = psi3.psi().psi();
+      twist_point psi10 = psi5.psi().psi().psi().psi().psi();
+
+      std::array<twist_point, 8> points{};
+      points[0] = a;
+      points[1] = a.add(psi5);
+      points[2] = a.add(psi10);
+      points[3] = points[1].add(psi10);
+      for (int i = 0; i < 4; ++i) {
+         points[i + 4] = points[i].add(psi3);
+      }
+
+      // The table is normalized with a single inversion so that the main loop
+      // can use mixed additions.
+      std::array<gfp2, 8> z_inv{}, scratch{};
+      for (std::size_t i = 0; i < points.size(); ++i) { z_inv[i] = points[i].z_; }
+      batch_invert(z_inv, scratch);
+
+      std::array<twist_affine, 8> table{};
+      for (std::size_t i = 0; i < points.size(); ++i) { table[i] = points[i].to_affine(z_inv[i]); }
+
+      auto sum      = infinity();
+      bool adjusted = target_lattice.foreach_signed_multi_scalar(scalar, [&sum, &table](bool negative, uint8_t index) {
+         sum = sum.double_();
+         sum = sum.add_mixed(negative ? table[index].neg() : table[index]);
+      });
+
+      if (adjusted) {
+         sum = sum.add(a.neg());
+      }
+      return sum;
+   }
+
    constexpr twist_point make_affine() const noexcept {
       if (z_.is_one()) {
          return *this;
@@ -180,22 +328,21 @@ struct twist_point {
          return { gfp2::zero(), gfp2::one(), gfp2::zero() };
       }
 
-      gfp2 z_inv  = z_.invert();
-      gfp2 t      = y_.mul(z_inv);
-      gfp2 z_inv2 = z_inv.square();
+      return make_affine(z_.invert());
+   }
 
-      twist_point c{};
-      c.y_ = t.mul(z_inv2);
-      t    = x_.mul(z_inv2);
-      c.x_ = t;
-      c.z_.set_one();
-      c.t_.set_one();
-      return c;
+   // make_affine returns the affine form of a finite point given z_inv=z⁻¹.
+   constexpr twist_point make_affine(const gfp2& z_inv) const noexcept { return from_affine(to_affine(z_inv)); }
+
+   // to_affine returns the affine coordinates of a finite point given z_inv=z⁻¹.
+   constexpr twist_affine to_affine(const gfp2& z_inv) const noexcept {
+      gfp2 z_inv2 = z_inv.square();
+      return { x_.mul(z_inv2), y_.mul(z_inv).mul(z_inv2) };
    }
 
    constexpr twist_point neg() const noexcept {
       const twist_point& a = *this;
-      return { a.x_, a.y_.neg(), a.z_, gfp2::zero() };
+      return { a.x_, a.y_.neg(), a.z_, a.t_ };
    }
 
    constexpr bool operator==(const twist_point& rhs) const noexcept {
@@ -205,6 +352,32 @@ struct twist_point {
    constexpr bool operator!=(const twist_point& rhs) const noexcept { return !(*this == rhs); }
 };
 
+// batch_make_affine replaces every point by make_affine() of it, sharing a
+// single field inversion between all of them, see batch_invert. z_inv and
+// scratch must have room for points.size() elements.
+inline void batch_make_affine(std::span<twist_point> points, std::span<gfp2> z_inv, std::span<gfp2> scratch) noexcept {
+   z_inv   = z_inv.first(points.size());
+   scratch = scratch.first(points.size());
+   for (std::size_t i = 0; i < points.size(); ++i) { z_inv[i] = points[i].z_; }
+   batch_invert(z_inv, scratch);
+
+   for (std::size_t i = 0; i < points.size(); ++i) {
+      twist_point& p = points[i];
+      if (p.z_.is_one()) {
+         continue;
+      } else if (p.is_infinity()) {
+         p = { gfp2::zero(), gfp2::one(), gfp2::zero() };
+      } else {
+         p = p.make_affine(z_inv[i]);
+      }
+   }
+}
+
+inline void batch_make_affine(std::span<twist_point> points) {
+   std::vector<gfp2> z_inv(points.size()), scratch(points.size());
+   batch_make_affine(points, z_inv, scratch);
+}
+
 #if defined (__clang__)
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wmissing-braces"
@@ -1,9 +1,12 @@
 
 
 #include "bn256/bn256.h"
+#include "gfp12.h"
+#include "random_255.h"
 
 #include <chrono>
 #include <iostream>
+#include <vector>
 
 
 template <typename Fun>
@@ -22,17 +25,103 @@ void benchmark(const char* metric, int count, Fun&& fun) {
 int main(int, const char**) {
 
 
+    bn256::gfp a1 = bn256::new_gfp(3);
+    benchmark("gfp::invert", 100000, [&]() { a1 = a1.invert(); });
+
+    bn256::gfp6  a6 = { { bn256::new_gfp(3), bn256::new_gfp(7) },
+                        { bn256::new_gfp(11), bn256::new_gfp(-5) },
+                        { bn256::new_gfp(2), bn256::new_gfp(13) } };
+    bn256::gfp12 a12 = { a6, a6.mul_tau() };
+    benchmark("gfp6::square", 100000, [&]() { a6 = a6.square(); });
+    benchmark("gfp6::mul", 100000, [&]() { a6 = a6.mul(a12.y_); });
+    benchmark("gfp12::square", 100000, [&]() { a12 = a12.square(); });
+    benchmark("gfp12::mul", 100000, [&]() { a12 = a12.mul(a12); });
+
     benchmark("g1::scaler_base_multi", 10000, []() {
         std::array<uint64_t,4> k = { 0xee59376474886cb2, 0x08cbb7b5caaeb745, 0xed73ab693b6472c0, 0x26a6bf93998520e0 };
         bn256::g1::scalar_base_mult(k);
     });
 
+    auto g1_point = bn256::g1::curve_gen.add(bn256::g1::curve_gen);
+    benchmark("g1::scalar_mult", 5000, [&]() {
+        std::array<uint64_t,4> k = { 0xee59376474886cb2, 0x08cbb7b5caaeb745, 0xed73ab693b6472c0, 0x26a6bf93998520e0 };
+        g1_point.scalar_mult(k);
+    });
+
     benchmark("g2::scaler_base_multi", 5000, []() {
          std::array<uint64_t,4> k = { 0x3851406aea252b4f, 0x21cb1e666869d8af, 0x5ab08c9973f01681, 0x201266baa5903baa };
         bn256::g2::scalar_base_mult(k);
     });
 
+    std::vector<bn256::g1> points(1000, bn256::g1::curve_gen.add(bn256::g1::curve_gen));
+    std::vector<uint8_t>   marshaled_points(points.size() * 64);
+    benchmark("g1::marshal (1000 points)", 20, [&]() {
+        for (std::size_t i = 0; i < points.size(); ++i)
+            points[i].marshal(std::span<uint8_t, 64>{ marshaled_points.data() + i * 64, 64 });
+    });
+    benchmark("g1::batch_marshal (1000 points)", 20, [&]() { bn256::g1::batch_marshal(points, marshaled_points); });
+
+    std::vector<bn256::uint255_t> scalars(points.size());
+    for (auto& k : scalars) k = bn256::random_255();
+    benchmark("g1::scalar_mult + add (1000 points)", 2, [&]() {
+        bn256::g1 sum{ bn256::g1::curve_gen };
+        for (std::size_t i = 0; i < points.size(); ++i) sum = sum.add(points[i].scalar_mult(scalars[i]));
+    });
+    benchmark("g1::multi_scalar_mult (1000 points)", 10, [&]() { bn256::g1::multi_scalar_mult(points, scalars); });
+    benchmark("g1::multi_scalar_mult (1000 points, 4 threads)", 10,
+              [&]() { bn256::g1::multi_scalar_mult(points, scalars, 4); });
+
+    std::vector<bn256::g1>        many_points(1 << 16, bn256::g1::curve_gen.add(bn256::g1::curve_gen));
+    std::vector<bn256::uint255_t> many_scalars(many_points.size());
+    for (auto& k : many_scalars) k = bn256::random_255();
+    benchmark("g1::multi_scalar_mult (2^16 points)", 2, [&]() { bn256::g1::multi_scalar_mult(many_points, many_scalars); });
+    benchmark("g1::multi_scalar_mult (2^16 points, 4 threads)", 2,
+              [&]() { bn256::g1::multi_scalar_mult(many_points, many_scalars, 4); });
+
+    auto marshaled_g1 = bn256::g1::curve_gen.marshal();
+    benchmark("g1::unmarshal", 5000, [&]() {
+        bn256::g1 q;
+        (void)q.unmarshal(marshaled_g1);
+    });
+
+    auto compressed_g1 = bn256::g1::curve_gen.marshal_compressed();
+    benchmark("g1::unmarshal_compressed", 5000, [&]() {
+        bn256::g1 q;
+        (void)q.unmarshal_compressed(compressed_g1);
+    });
+
+    auto marshaled_g2 = bn256::g2::twist_gen.marshal();
+    benchmark("g2::unmarshal", 5000, [&]() {
+        bn256::g2 q;
+        (void)q.unmarshal(marshaled_g2);
+    });
+
+    auto compressed_g2 = bn256::g2::twist_gen.marshal_compressed();
+    benchmark("g2::unmarshal_compressed", 5000, [&]() {
+        bn256::g2 q;
+        (void)q.unmarshal_compressed(compressed_g2);
+    });
+
+    auto gt_gen = bn256::pair(bn256::g1::curve_gen, bn256::g2::twist_gen);
+    benchmark("gt::scalar_mult", 2000, [&]() {
+        std::array<uint64_t,4> k = { 0x3851406aea252b4f, 0x21cb1e666869d8af, 0x5ab08c9973f01681, 0x201266baa5903baa };
+        gt_gen.scalar_mult(k);
+    });
+    benchmark("gt::subgroup_scalar_mult", 2000, [&]() {
+        std::array<uint64_t,4> k = { 0x3851406aea252b4f, 0x21cb1e666869d8af, 0x5ab08c9973f01681, 0x201266baa5903baa };
+        gt_gen.subgroup_scalar_mult(k);
+    });
+
     benchmark("bn256 pair", 1000, []() { bn256::pair(bn256::g1::curve_gen, bn256::g2::twist_gen); });
 
+    bn256::g2_prepared prepared_gen{ bn256::g2::twist_gen };
+    benchmark("bn256 pair (prepared g2)", 1000, [&]() { bn256::pair(bn256::g1::curve_gen, prepared_gen); });
+
+    std::array<bn256::g1, 4> check_g1 = { bn256::g1::curve_gen, bn256::g1::curve_gen, bn256::g1::curve_gen,
+                                          bn256::g1::curve_gen.neg() };
+    std::array<bn256::g2, 4> check_g2 = { bn256::g2::twist_gen, bn256::g2::twist_gen, bn256::g2::twist_gen,
+                                          bn256::g2::twist_gen.scalar_mult({ 3, 0, 0, 0 }) };
+    benchmark("bn256 pairing_check (4 pairs)", 200, [&]() { bn256::pairing_check(check_g1, check_g2); });
+
     return 0;
 }
@@ -1,7 +1,12 @@
 #include "curve.h"
+#include "fixed_base.h"
+#include "msm.h"
+#include "optate.h"
+#include "random_255.h"
 #include "twist.h"
 #include <bn256/bn256.h>
 #include <catch2/catch_test_macros.hpp>
+#include <climits>
 #include <memory>
 
 #if defined(__clang__)
@@ -32,6 +37,186 @@ TEST_CASE("test g2 marshall", "[bn256]") {
    CHECK(ma == mb); // "fail if bytes are different"
 }
 
+TEST_CASE("test batch marshal", "[bn256]") {
+   std::vector<bn256::g1> as;
+   std::vector<bn256::g2> bs;
+   // More than two chunks of 64 points.
+   for (int i = 0; i < 140; ++i) {
+      as.push_back(std::get<1>(bn256::ramdom_g1()));
+      bs.push_back(std::get<1>(bn256::ramdom_g2()));
+   }
+   as.push_back(bn256::g1{ bn256::curve_point::infinity() });
+   bs.push_back(bn256::g2{ bn256::twist_point::infinity() });
+   as.push_back(bn256::g1::curve_gen);
+   bs.push_back(bn256::g2::twist_gen);
+
+   std::vector<uint8_t> ma(as.size() * 64), mb(bs.size() * 128);
+   bn256::g1::batch_marshal(as, ma);
+   bn256::g2::batch_marshal(bs, mb);
+   for (std::size_t i = 0; i < as.size(); ++i) {
+      CHECK(std::equal(ma.begin() + i * 64, ma.begin() + (i + 1) * 64, as[i].marshal().begin()));
+      CHECK(std::equal(mb.begin() + i * 128, mb.begin() + (i + 1) * 128, bs[i].marshal().begin()));
+   }
+
+   auto normalized_as = as;
+   auto normalized_bs = bs;
+   bn256::g1::batch_normalize(normalized_as);
+   bn256::g2::batch_normalize(normalized_bs);
+   for (std::size_t i = 0; i < as.size(); ++i) {
+      CHECK(normalized_as[i].p() == as[i].p().make_affine());
+      CHECK(normalized_bs[i].p() == bs[i].p().make_affine());
+      CHECK(normalized_as[i].marshal() == as[i].marshal());
+      CHECK(normalized_bs[i].marshal() == bs[i].marshal());
+   }
+
+   // Points that do not fit in out are skipped and out is not written past them.
+   std::vector<uint8_t> short_ma(3 * 64 + 10, 0xff);
+   bn256::g1::batch_marshal(as, short_ma);
+   CHECK(std::equal(ma.begin(), ma.begin() + 3 * 64, short_ma.begin()));
+   CHECK(std::all_of(short_ma.begin() + 3 * 64, short_ma.end(), [](uint8_t b) { return b == 0xff; }));
+}
+
+TEST_CASE("test compressed marshal", "[bn256]") {
+   for (int i = 0; i < 20; ++i) {
+      auto [_a, ga] = bn256::ramdom_g1();
+      auto [_b, gb] = bn256::ramdom_g2();
+      for (const auto& a : { ga, ga.neg() }) {
+         bn256::g1 c{};
+         REQUIRE(c.unmarshal_compressed(a.marshal_compressed()) == std::error_code{});
+         CHECK(c.marshal() == a.marshal());
+      }
+      for (const auto& b : { gb, gb.neg() }) {
+         bn256::g2 c{};
+         REQUIRE(c.unmarshal_compressed(b.marshal_compressed()) == std::error_code{});
+         CHECK(c.marshal() == b.marshal());
+      }
+   }
+
+   bn256::g1 inf1{ bn256::curve_point::infinity() };
+   bn256::g2 inf2{ bn256::twist_point::infinity() };
+   auto      m1 = inf1.marshal_compressed();
+   auto      m2 = inf2.marshal_compressed();
+   CHECK(m1[0] == 0x40);
+   CHECK(m2[0] == 0x40);
+   bn256::g1 c1{ bn256::curve_gen };
+   bn256::g2 c2{ bn256::twist_gen };
+   REQUIRE(c1.unmarshal_compressed(m1) == std::error_code{});
+   REQUIRE(c2.unmarshal_compressed(m2) == std::error_code{});
+   CHECK(c1.p().is_infinity());
+   CHECK(c2.p().is_infinity());
+
+   // Infinity with other bits set.
+   m1[31] = 1;
+   CHECK(c1.unmarshal_compressed(m1) != std::error_code{});
+   m2[0] = 0xc0;
+   CHECK(c2.unmarshal_compressed(m2) != std::error_code{});
+
+   // x = 0 is not on the G₁ curve, as 3 is not a square.
+   std::array<uint8_t, 32> zero1{};
+   CHECK(c1.unmarshal_compressed(zero1) != std::error_code{});
+
+   // Find an x whose point is on the twist but, as the cofactor is large,
+   // not in G₂, so that the rejection comes from the subgroup check and not
+   // from the square root.
+   std::array<uint8_t, 64> x2{};
+   for (uint8_t k = 1;; ++k) {
+      const bn256::gfp2 x{ bn256::gfp{}, bn256::new_gfp(k) };
+      const bn256::gfp2 y2 = x.square().mul(x).add(bn256::twist_point::twist_b);
+      const bn256::gfp2 y  = y2.sqrt();
+      if (y.square() == y2) {
+         const bn256::twist_point q{ x, y, bn256::gfp2::one(), bn256::gfp2::one() };
+         REQUIRE(!q.is_in_subgroup());
+         x2[63] = k;
+         break;
+      }
+   }
+   CHECK(c2.unmarshal_compressed(x2) != std::error_code{});
+   x2[0] |= 0x80;
+   CHECK(c2.unmarshal_compressed(x2) != std::error_code{});
+
+   // The coordinate must be below p.
+   std::array<uint8_t, 32> big1{};
+   big1.fill(0xff);
+   big1[0] = 0x3f;
+   CHECK(c1.unmarshal_compressed(big1) != std::error_code{});
+}
+
+TEST_CASE("test fixed base mult", "[bn256]") {
+   const bn256::fixed_base_table<bn256::curve_point, 2> table2{ bn256::curve_gen };
+   const bn256::fixed_base_table<bn256::curve_point, 3> table3{ bn256::curve_gen };
+   const bn256::fixed_base_table<bn256::twist_point, 4> table4{ bn256::twist_gen };
+
+   std::vector<bn256::uint255_t> ks = {
+      { 0, 0, 0, 0 },
+      { 1, 0, 0, 0 },
+      { 0xffffffffffffffff, 0xffffffffffffffff, 0xffffffffffffffff, 0xffffffffffffffff },
+      // The order of the groups.
+      { 0x43e1f593f0000001, 0x2833e84879b97091, 0xb85045b68181585d, 0x30644e72e131a029 },
+   };
+   for (int i = 0; i < 10; ++i) ks.push_back(bn256::random_255());
+
+   for (const auto& k : ks) {
+      auto p = bn256::curve_gen.mul(k).make_affine();
+      auto q = bn256::twist_gen.gls_mul(k).make_affine();
+      CHECK(table2.mul(k).make_affine() == p);
+      CHECK(table3.mul(k).make_affine() == p);
+      CHECK(table4.mul(k).make_affine() == q);
+      CHECK(bn256::g1::scalar_base_mult(k).marshal() == bn256::g1{ p }.marshal());
+      CHECK(bn256::g2::scalar_base_mult(k).marshal() == bn256::g2{ q }.marshal());
+   }
+}
+
+TEST_CASE("test curve point wnaf mul", "[bn256]") {
+   auto reference = [](const bn256::curve_point& a, const bn256::uint255_t& k) {
+      auto sum = bn256::curve_point::infinity();
+      for (int i = 255; i >= 0; --i) {
+         sum = sum.double_();
+         if ((k[i / 64] >> (i % 64)) & 1) {
+            sum = sum.add(a);
+         }
+      }
+      return sum.make_affine();
+   };
+
+   auto [_, g] = bn256::ramdom_g1();
+   const bn256::curve_point a = g.p();
+   for (int i = 0; i < 10; ++i) {
+      auto k = bn256::random_255();
+      auto p = reference(a, k);
+      CHECK(a.mul(k).make_affine() == p);
+      CHECK(a.wnaf_mul<2>(k).make_affine() == p);
+      CHECK(a.wnaf_mul<3>(k).make_affine() == p);
+      CHECK(a.wnaf_mul<6>(k).make_affine() == p);
+   }
+   const bn256::uint255_t zero = { 0, 0, 0, 0 }, one = { 1, 0, 0, 0 };
+   CHECK(a.mul(zero).is_infinity());
+   CHECK(a.mul(one).make_affine() == a.make_affine());
+   CHECK(bn256::curve_point::infinity().mul(one).is_infinity());
+}
+
+TEST_CASE("test mixed addition", "[bn256]") {
+   auto [_a, g] = bn256::ramdom_g1();
+   auto [_b, h] = bn256::ramdom_g1();
+   // a is not affine, b is.
+   const bn256::curve_point a  = g.p().double_();
+   const bn256::curve_point b  = h.p().make_affine();
+   const bn256::curve_affine ba = { b.x_, b.y_ };
+   CHECK(a.add_mixed(ba).make_affine() == a.add(b).make_affine());
+   CHECK(b.add_mixed(ba).make_affine() == b.double_().make_affine());
+   CHECK(b.neg().add_mixed(ba).is_infinity());
+   CHECK(bn256::curve_point::infinity().add_mixed(ba).make_affine() == b);
+
+   auto [_c, q] = bn256::ramdom_g2();
+   auto [_d, r] = bn256::ramdom_g2();
+   const bn256::twist_point c  = q.p().double_();
+   const bn256::twist_point d  = r.p().make_affine();
+   const bn256::twist_affine da = { d.x_, d.y_ };
+   CHECK(c.add_mixed(da).make_affine() == c.add(d).make_affine());
+   CHECK(d.add_mixed(da).make_affine() == d.double_().make_affine());
+   CHECK(d.neg().add_mixed(da).is_infinity());
+   CHECK(bn256::twist_point::infinity().add_mixed(da).make_affine() == d);
+}
+
 TEST_CASE("test bilinearity", "[bn256]") {
    bn256::g1 c1{ bn256::curve_gen };
    bn256::g2 c2{ bn256::twist_gen };
@@ -48,6 +233,75 @@ TEST_CASE("test bilinearity", "[bn256]") {
    }
 }
 
+TEST_CASE("test multi_miller", "[bn256]") {
+   std::vector<bn256::twist_point> qs;
+   std::vector<bn256::curve_point> ps;
+   bn256::gfp12                    expected = bn256::gfp12::one();
+
+   for (auto i = 0U; i < 3; ++i) {
+      auto [a, p] = bn256::ramdom_g1();
+      auto [b, q] = bn256::ramdom_g2();
+      qs.push_back(q.p());
+      ps.push_back(p.p());
+      expected = expected.mul(bn256::miller(q.p(), p.p()));
+   }
+
+   CHECK(bn256::multi_miller(qs, ps) == expected);
+   CHECK(bn256::multi_miller(std::span<const bn256::twist_point>{}, {}).is_one());
+}
+
+TEST_CASE("test sparse line multiplication", "[bn256]") {
+   auto [a, p]   = bn256::ramdom_g1();
+   auto [b, q]   = bn256::ramdom_g2();
+   auto prepared = bn256::prepare_twist(q.p());
+   auto ret      = bn256::miller(q.p(), p.p());
+   auto ps       = p.p().make_affine();
+
+   // evaluated returns the line as a full gfp12 element.
+   auto evaluated = [&ps](const bn256::line_coeffs& line) {
+      return bn256::gfp12{ { bn256::gfp2::zero(), line.a, line.b.mul_scalar(ps.x_) },
+                           { bn256::gfp2::zero(), bn256::gfp2::zero(), line.c.mul_scalar(ps.y_) } };
+   };
+
+   const auto& l1 = prepared.lines[0];
+   const auto& l2 = prepared.lines[1];
+
+   auto expected = ret.mul(evaluated(l1));
+   auto actual   = ret;
+   bn256::mul_line(actual, l1, ps);
+   CHECK(actual == expected);
+
+   auto lines = bn256::mul_lines(l1, l2, ps);
+   CHECK(lines == evaluated(l1).mul(evaluated(l2)));
+
+   expected = ret.mul(lines);
+   actual   = ret;
+   bn256::mul_line_pair(actual, lines);
+   CHECK(actual == expected);
+
+   CHECK(ret.x_.mul_sparse(l1.a, l1.b) == ret.x_.mul({ bn256::gfp2::zero(), l1.a, l1.b }));
+}
+
+TEST_CASE("test g2_prepared", "[bn256]") {
+   auto [a, p] = bn256::ramdom_g1();
+   auto [b, q] = bn256::ramdom_g2();
+
+   bn256::g2_prepared prepared_q{ q };
+   CHECK(bn256::pair(p, prepared_q) == bn256::pair(p, q));
+
+   bn256::g2_prepared prepared_gen{ bn256::g2::twist_gen };
+   std::vector<bn256::g1>          g1_vec = { p, p.neg() };
+   std::vector<bn256::g2_prepared> g2_vec = { prepared_gen, prepared_gen };
+   CHECK(bn256::pairing_check(g1_vec, g2_vec));
+
+   g1_vec = { p, p };
+   CHECK(!bn256::pairing_check(g1_vec, g2_vec));
+
+   bn256::g2_prepared infinity{ bn256::g2::scalar_base_mult({ 0, 0, 0, 0 }) };
+   CHECK(infinity.is_infinity());
+   CHECK(bn256::pair(p, infinity).p().is_one());
+}
+
 TEST_CASE("test tripartite_diffie_hellman", "[bn256]") {
 
    std::array<uint64_t, 4> a = { (uint64_t)rand(), 0, 0, 0 };
@@ -82,6 +336,34 @@ TEST_CASE("test g2_self_addition", "[bn256]") {
    CHECK(p.unmarshal(m) == std::error_code{}); // "fail if unmarshalling p.Add(p, p) ∉ G₂"
 }
 
+TEST_CASE("test g2 subgroup check", "[bn256]") {
+   for (auto i = 0U; i < 4; ++i) {
+      auto [_, q] = bn256::ramdom_g2();
+      CHECK(q.p().is_in_subgroup());
+      CHECK(bn256::g2{ q.p().psi() }.marshal() == bn256::g2{ q.p().mul(bn256::constants::p) }.marshal());
+   }
+
+   // a point on the twist curve which is not in G₂
+   const bn256::twist_point outside = {
+      {
+            { 0xce64975397eab6f0, 0x277d15e281be14ea, 0xd16a6661c08bc647, 0x02319ec9af12cb41 },
+            { 0x5f0ff67ae9de84cf, 0xa594daff9be7ead7, 0xe7c9dfa1e168763f, 0x10a4401baeb310df },
+      },
+      {
+            { 0x3f5867591eeb6c84, 0xda98730b32f82bb4, 0xc8eb42a6403061f6, 0x09933c34308df915 },
+            { 0x771623922a127af0, 0xa5937b32e561919f, 0xd9a47d3a1f8f918a, 0x2adf5a324f7a4b59 },
+      },
+      bn256::gfp2::one(),
+      bn256::gfp2::one()
+   };
+   CHECK(!outside.mul(bn256::constants::order).is_infinity());
+   CHECK(!outside.is_in_subgroup());
+   CHECK(!outside.is_on_curve());
+
+   bn256::g2 q{ outside };
+   CHECK(q.unmarshal(q.marshal()));
+}
+
 TEST_CASE("test twist point mul", "[bn256]") {
    const bn256::uint255_t k = { 0x1ee155ddfb789c17, 0x2fe306f28ed08574, 0x8f80f739c3f3b7a3, 0xa2422041c5891a94 };
    bn256::g2              p = bn256::g2::scalar_base_mult(k);
@@ -102,7 +384,126 @@ TEST_CASE("test twist point mul", "[bn256]") {
       { bn256::new_gfp(0), bn256::new_gfp(0) }
    };
 
-   CHECK(p.p() == expected);
+   CHECK(p.p().make_affine() == expected.make_affine());
+}
+
+TEST_CASE("test gfp12 cyclotomic_square", "[bn256]") {
+   bn256::gfp12 a = bn256::pair(bn256::g1::scalar_base_mult({ (uint64_t)rand(), 0, 0, 0 }),
+                                bn256::g2::scalar_base_mult({ 1, 0, 0, 0 }))
+                          .p();
+
+   for (int i = 0; i < 4; ++i) {
+      CHECK(a.cyclotomic_square() == a.square());
+      a = a.mul(a.frobenius());
+   }
+   CHECK(a.cyclotomic_exp(bn256::constants::u) == a.exp(bn256::constants::u));
+
+   const bn256::uint255_t k = { (uint64_t)rand() << 32 | (uint64_t)rand(), (uint64_t)rand() << 32 | (uint64_t)rand(),
+                                (uint64_t)rand() << 32 | (uint64_t)rand(), (uint64_t)rand() << 32 | (uint64_t)rand() };
+   CHECK(a.cyclotomic_exp(k) == a.exp(k));
+   CHECK(a.cyclotomic_exp(bn256::uint255_t{}).is_one());
+}
+
+TEST_CASE("test karatsuba multiplication", "[bn256]") {
+   auto random_gfp2 = [] {
+      return bn256::gfp2{ bn256::gfp{ bn256::random_255() }.mont_decode(),
+                          bn256::gfp{ bn256::random_255() }.mont_decode() };
+   };
+   auto random_gfp6 = [&] { return bn256::gfp6{ random_gfp2(), random_gfp2(), random_gfp2() }; };
+
+   // the schoolbook forms with four multiplications
+   auto mul2 = [](const bn256::gfp2& a, const bn256::gfp2& b) {
+      return bn256::gfp2{ a.x_.mul(b.y_).add(b.x_.mul(a.y_)), a.y_.mul(b.y_).sub(a.x_.mul(b.x_)) };
+   };
+   auto mul12 = [](const bn256::gfp12& a, const bn256::gfp12& b) {
+      return bn256::gfp12{ a.x_.mul(b.y_).add(b.x_.mul(a.y_)), a.y_.mul(b.y_).add(a.x_.mul(b.x_).mul_tau()) };
+   };
+
+   const bn256::gfp pm1 = { 0x3c208c16d87cfd46, 0x97816a916871ca8d, 0xb85045b68181585d, 0x30644e72e131a029 };
+   const bn256::gfp2 max = { pm1, pm1 };
+   CHECK(max.mul(max) == mul2(max, max));
+   CHECK(max.mul(bn256::gfp2::zero()).is_zero());
+
+   for (int i = 0; i < 100; ++i) {
+      bn256::gfp2 a = random_gfp2(), b = random_gfp2();
+      CHECK(a.mul(b) == mul2(a, b));
+      CHECK(a.mul(a) == a.square());
+
+      bn256::gfp12 c = { random_gfp6(), random_gfp6() }, d = { random_gfp6(), random_gfp6() };
+      CHECK(c.mul(d) == mul12(c, d));
+      CHECK(c.mul(c) == c.square());
+   }
+}
+
+TEST_CASE("test fast_final_exponentiation", "[bn256]") {
+   // m = 2u(6u²+3u+1)
+   const bn256::uint255_t m = { 0x2e5d4e223ddedaf4, 0x1ea96b02d9d9e38d, 0x3bec47df15e307c8, 0 };
+
+   for (int i = 0; i < 4; ++i) {
+      auto p = bn256::g1::scalar_base_mult({ (uint64_t)rand(), 0, 0, 0 });
+      auto q = bn256::g2::scalar_base_mult({ (uint64_t)rand(), 0, 0, 0 });
+      auto f = bn256::miller(q.p(), p.p());
+      CHECK(bn256::fast_final_exponentiation(f) == bn256::final_exponentiation(f).exp(m));
+   }
+   CHECK(bn256::fast_final_exponentiation(bn256::gfp12::one()).is_one());
+}
+
+TEST_CASE("test gfp12 gls_exp", "[bn256]") {
+   const bn256::gfp12 a = bn256::pair(bn256::g1::scalar_base_mult({ (uint64_t)rand(), 0, 0, 0 }),
+                                      bn256::g2::scalar_base_mult({ 1, 0, 0, 0 }))
+                                .p();
+
+   std::vector<bn256::uint255_t> scalars = {
+      { 0, 0, 0, 0 },
+      { 1, 0, 0, 0 },
+      { 0x43e1f593f0000000, 0x2833e84879b97091, 0xb85045b68181585d, 0x30644e72e131a029 },
+      { 0xffffffffffffffff, 0xffffffffffffffff, 0xffffffffffffffff, 0x7fffffffffffffff },
+   };
+   for (int i = 0; i < 8; ++i) {
+      scalars.push_back({ (uint64_t)rand() << 32 | (uint64_t)rand(), (uint64_t)rand() << 32 | (uint64_t)rand(),
+                          (uint64_t)rand() << 32 | (uint64_t)rand(), (uint64_t)rand() << 32 | (uint64_t)rand() });
+   }
+
+   for (const auto& k : scalars) {
+      CHECK(a.gls_exp(k) == a.exp(k));
+   }
+}
+
+TEST_CASE("test gt scalar_mult of miller output", "[bn256]") {
+   auto [a, p] = bn256::ramdom_g1();
+   auto [b, q] = bn256::ramdom_g2();
+
+   // A miller output is not in G_T, so scalar_mult has to use the generic
+   // exponentiation; finalize commutes with it.
+   const bn256::gt m = bn256::miller(p, q);
+   auto            k = bn256::random_255();
+   CHECK(m.scalar_mult(k).p() == m.p().exp(k));
+   CHECK(m.scalar_mult(a).finalize() == bn256::miller(p.scalar_mult(a), q).finalize());
+   CHECK(m.scalar_mult(a).finalize() == bn256::pair(p, q).subgroup_scalar_mult(a));
+
+   const bn256::gt e = bn256::pair(p, q);
+   CHECK(e.subgroup_scalar_mult(k) == e.scalar_mult(k));
+}
+
+TEST_CASE("test twist point gls_mul", "[bn256]") {
+   const bn256::twist_point q = bn256::g2::scalar_base_mult({ (uint64_t)rand(), 0, 0, 0 }).p();
+
+   std::vector<bn256::uint255_t> scalars = {
+      { 0, 0, 0, 0 },
+      { 1, 0, 0, 0 },
+      { 2, 0, 0, 0 },
+      { 0x43e1f593f0000000, 0x2833e84879b97091, 0xb85045b68181585d, 0x30644e72e131a029 },
+      { 0x43e1f593f0000001, 0x2833e84879b97091, 0xb85045b68181585d, 0x30644e72e131a029 },
+      { 0xffffffffffffffff, 0xffffffffffffffff, 0xffffffffffffffff, 0x7fffffffffffffff },
+   };
+   for (int i = 0; i < 16; ++i) {
+      scalars.push_back({ (uint64_t)rand() << 32 | (uint64_t)rand(), (uint64_t)rand() << 32 | (uint64_t)rand(),
+                          (uint64_t)rand() << 32 | (uint64_t)rand(), (uint64_t)rand() << 32 | (uint64_t)rand() });
+   }
+
+   for (const auto& k : scalars) {
+      CHECK(q.gls_mul(k).make_affine() == q.mul(k).make_affine());
+   }
 }
 
 std::vector<uint8_t> unhex(const char* str, std::size_t len) {
@@ -155,6 +556,11 @@ static int32_t g1_scalar_mul(std::vector<uint8_t>&& marshaled_g1,
                                std::span<uint8_t, 64>(result));
 }
 
+static int32_t g1_multi_scalar_mul(const std::vector<uint8_t>& marshaled_g1_scalar_pairs,
+                                   std::vector<uint8_t>& result, unsigned threads = 1) {
+   return bn256::g1_multi_scalar_mul(marshaled_g1_scalar_pairs, std::span<uint8_t, 64>(result), threads);
+}
+
 TEST_CASE("test g1_add", "[bn256]") {
 
    std::vector<uint8_t> result;
@@ -270,6 +676,13 @@ TEST_CASE("test pair", "[bn256]") {
       std::array<g1g2_pair, 2> case1{ a, b };
 
       CHECK(bn256::pairing_check(to_bytes(case1), yield) == 1);
+
+      // The callback runs throughout the Miller loop, not only while parsing:
+      // once per preparation, once per loop iteration and once before the final
+      // exponentiation.
+      int yields = 0;
+      CHECK(bn256::pairing_check(to_bytes(case1), [&yields]() { ++yields; }) == 1);
+      CHECK(yields == 2 + 64 + 1);
    }
    { // test2: 1 pair => (G1_a,G2_a) ; alt_bn128_error::none; false
       g1g2_pair a{ "0000000000000000000000000000000000000000000000000000000000000001", // G1_a.x
@@ -308,3 +721,75 @@ TEST_CASE("test pair", "[bn256]") {
       CHECK(bn256::pairing_check(a.to_bytes(), yield) == -1);
    }
 }
+
+TEST_CASE("test g1 multi_scalar_mult", "[bn256]") {
+   auto naive = [](const std::vector<bn256::g1>& points, const std::vector<bn256::uint255_t>& scalars) {
+      bn256::g1 sum{ bn256::curve_point::infinity() };
+      for (std::size_t i = 0; i < points.size(); ++i) { sum = sum.add(points[i].scalar_mult(scalars[i])); }
+      return sum.p().make_affine();
+   };
+
+   for (std::size_t n : { 0, 1, 2, 7, 100, 300 }) {
+      std::vector<bn256::g1>        points;
+      std::vector<bn256::uint255_t> scalars;
+      for (std::size_t i = 0; i < n; ++i) {
+         auto [k, p] = bn256::ramdom_g1();
+         // Mix affine and Jacobian points.
+         points.push_back(i % 2 ? p : bn256::g1{ p.p().double_() });
+         scalars.push_back(bn256::random_255());
+      }
+      if (n >= 7) {
+         points[1]  = bn256::g1{ bn256::curve_point::infinity() };
+         scalars[2] = { 0, 0, 0, 0 };
+         scalars[3] = { UINT64_MAX, UINT64_MAX, UINT64_MAX, UINT64_MAX };
+         points[5]  = points[4];
+         scalars[5] = scalars[4];
+         points[6]  = points[4].neg();
+         scalars[6] = scalars[4];
+      }
+
+      const auto expected = naive(points, scalars);
+      CHECK(bn256::g1::multi_scalar_mult(points, scalars).p().make_affine() == expected);
+      CHECK(bn256::g1::multi_scalar_mult(points, scalars, 3).p().make_affine() == expected);
+      // The thread count is capped by the number of cores.
+      CHECK(bn256::g1::multi_scalar_mult(points, scalars, UINT_MAX).p().make_affine() == expected);
+
+      // Exercise the slicing of the points regardless of the number of cores.
+      std::vector<bn256::curve_point> ps;
+      for (const auto& p : points) ps.push_back(p.p());
+      CHECK(bn256::multi_scalar_mult<bn256::curve_point>(ps, scalars, 3).make_affine() == expected);
+      CHECK(bn256::multi_scalar_mult<bn256::curve_point>(ps, scalars, 64).make_affine() == expected);
+   }
+}
+
+TEST_CASE("test g1_multi_scalar_mul", "[bn256]") {
+   std::vector<uint8_t> result(64), expected(64);
+
+   std::vector<uint8_t> pairs =
+      "007c43fcd125b2b13e2521e395a81727710a46b34fe279adbf1b94c72f7f91360db2f980370fb8962751c6ff064f4516a6a93d563388518bb77ab9a6b30755be"
+      "0312ed43559cf8ecbab5221256a56e567aac5035308e3f1d54954d8b97cd1c9b"_unhex;
+   CHECK(g1_multi_scalar_mul(pairs, result) == 0);
+   CHECK(result ==
+         "2d66cdeca5e1715896a5a924c50a149be87ddd2347b862150fbb0fd7d0b1833c11c76319ebefc5379f7aa6d85d40169a612597637242a4bbb39e5cd3b844becd"_unhex);
+
+   // Adding the same pair twice doubles the product.
+   pairs.insert(pairs.end(), pairs.begin(), pairs.end());
+   CHECK(g1_multi_scalar_mul(pairs, result, 2) == 0);
+   CHECK(g1_add(
+            "2d66cdeca5e1715896a5a924c50a149be87ddd2347b862150fbb0fd7d0b1833c11c76319ebefc5379f7aa6d85d40169a612597637242a4bbb39e5cd3b844becd"_unhex,
+            "2d66cdeca5e1715896a5a924c50a149be87ddd2347b862150fbb0fd7d0b1833c11c76319ebefc5379f7aa6d85d40169a612597637242a4bbb39e5cd3b844becd"_unhex,
+            expected) == 0);
+   CHECK(result == expected);
+
+   // An empty input gives the point at infinity.
+   CHECK(g1_multi_scalar_mul({}, result) == 0);
+   CHECK(result == std::vector<uint8_t>(64));
+
+   // Truncated input and points not on the curve are rejected.
+   pairs.pop_back();
+   CHECK(g1_multi_scalar_mul(pairs, result) == -1);
+   CHECK(g1_multi_scalar_mul(
+            "0db2f980370fb8962751c6ff064f4516a6a93d563388518bb77ab9a6b30755be007c43fcd125b2b13e2521e395a81727710a46b34fe279adbf1b94c72f7f9136"
+            "0312ed43559cf8ecbab5221256a56e567aac5035308e3f1d54954d8b97cd1c9b"_unhex,
+            result) == -1);
+}
@@ -1,8 +1,10 @@
 #include <constants.h>
 #include <gfp.h>
+#include <gfp2.h>
 #include <gfp_generic.h>
 #include <iostream>
 #include <iosfwd>
+#include <random_255.h>
 #include <catch2/catch_test_macros.hpp>
 #if defined (__clang__)
 #pragma clang diagnostic ignored "-Wmissing-braces"
@@ -18,6 +20,9 @@ TEST_CASE("test_gfp_neg", "[gfp]"){
    CHECK(bn256::gfp_neg(n) == w);
 }
 
+// The known answer tests for addition and multiplication use operands above 2p,
+// which are outside the domain of the redundant representation.
+#ifndef BN256_REDUNDANT
 // Tests that addition works the same way on both assembly-optimized and C++
 // implementation.
 TEST_CASE("test_gfp_add", "[gfp]"){
@@ -29,6 +34,8 @@ TEST_CASE("test_gfp_add", "[gfp]"){
    CHECK(bn256::gfp_add(a, b) == w);
 }
 
+#endif
+
 // Tests that subtraction works the same way on both assembly-optimized and C++
 // implementation.
 TEST_CASE("test_gfp_sub", "[gfp]"){
@@ -39,6 +46,7 @@ TEST_CASE("test_gfp_sub", "[gfp]"){
    CHECK( bn256::gfp_sub(a, b) == w);
 }
 
+#ifndef BN256_REDUNDANT
 // Tests that multiplication works the same way on both assembly-optimized and C++
 // implementation.
 TEST_CASE("test_gfp_mul", "[gfp]"){
@@ -47,4 +55,245 @@ TEST_CASE("test_gfp_mul", "[gfp]"){
    constexpr bn256::gfp w = {0xcbcbd377f7ad22d3, 0x3b89ba5d849379bf, 0x87b61627bd38b6d2, 0xc44052a2a0e654b2};
    static_assert( bn256::gfp_mul(a, b) == w ); // multiplication mismatch
    CHECK(bn256::gfp_mul(a, b) == w);
-}
\ No newline at end of file
+}
+
+#endif
+
+// Tests that the MULX/ADX kernel, when it is enabled, agrees with the C++
+// implementation, including for unreduced inputs.
+TEST_CASE("test_gfp_mul_generic", "[gfp]"){
+   const std::array<bn256::gfp, 5> edge = {
+      bn256::gfp{ 0, 0, 0, 0 },
+      bn256::gfp{ 1, 0, 0, 0 },
+      bn256::gfp{ 0x3c208c16d87cfd46, 0x97816a916871ca8d, 0xb85045b68181585d, 0x30644e72e131a029 }, // p-1
+      bn256::gfp{ 0x3c208c16d87cfd47, 0x97816a916871ca8d, 0xb85045b68181585d, 0x30644e72e131a029 }, // p
+      bn256::gfp{ 0xffffffffffffffff, 0xffffffffffffffff, 0xffffffffffffffff, 0xffffffffffffffff },
+   };
+   for (const auto& a : edge)
+      for (const auto& b : edge)
+         CHECK(bn256::gfp_mul(a, b) == bn256::gfp_mul_generic(a, b));
+
+   for (int i = 0; i < 1000; ++i) {
+      bn256::gfp a{ bn256::random_255() }, b{ bn256::random_255() };
+      CHECK(bn256::gfp_mul(a, b) == bn256::gfp_mul_generic(a, b));
+   }
+}
+
+// Tests that the word-by-word Montgomery multiplication and reduction agree
+// with the full-product implementation, including for unreduced inputs.
+TEST_CASE("test_gfp_mul_cios", "[gfp]"){
+   constexpr bn256::gfp a = {0x0123456789abcdef, 0xfedcba9876543210, 0xdeadbeefdeadbeef, 0xfeebdaedfeebdaed};
+   constexpr bn256::gfp b = {0xfedcba9876543210, 0x0123456789abcdef, 0xfeebdaedfeebdaed, 0xdeadbeefdeadbeef};
+   static_assert( bn256::gfp_mul_cios(a, b) == bn256::gfp_mul_generic(a, b) ); // multiplication mismatch
+
+   const std::array<bn256::gfp, 5> edge = {
+      bn256::gfp{ 0, 0, 0, 0 },
+      bn256::gfp{ 1, 0, 0, 0 },
+      bn256::gfp{ 0x3c208c16d87cfd46, 0x97816a916871ca8d, 0xb85045b68181585d, 0x30644e72e131a029 }, // p-1
+      bn256::gfp{ 0x3c208c16d87cfd47, 0x97816a916871ca8d, 0xb85045b68181585d, 0x30644e72e131a029 }, // p
+      bn256::gfp{ 0xffffffffffffffff, 0xffffffffffffffff, 0xffffffffffffffff, 0xffffffffffffffff },
+   };
+   for (const auto& a : edge)
+      for (const auto& b : edge)
+         CHECK(bn256::gfp_mul_cios(a, b) == bn256::gfp_mul_generic(a, b));
+
+   for (int i = 0; i < 1000; ++i) {
+      bn256::gfp a{ bn256::random_255() }, b{ bn256::random_255() };
+      CHECK(bn256::gfp_mul_cios(a, b) == bn256::gfp_mul_generic(a, b));
+
+      auto lo = bn256::random_255(), hi = bn256::random_255();
+      std::array<uint64_t, 8> T = { lo[0], lo[1], lo[2], lo[3], hi[0], hi[1], hi[2], hi[3] };
+      CHECK(bn256::gfp_mont_reduce_cios(T) == bn256::gfp_mont_reduce_generic(T));
+   }
+}
+
+// Tests that the squaring kernel agrees with multiplication.
+TEST_CASE("test_gfp_sqr", "[gfp]"){
+   constexpr bn256::gfp a = {0x0123456789abcdef, 0xfedcba9876543210, 0xdeadbeefdeadbeef, 0xfeebdaedfeebdaed};
+   static_assert( bn256::gfp_sqr(a) == bn256::gfp_mul(a, a) ); // squaring mismatch
+   CHECK(bn256::gfp_sqr(a) == bn256::gfp_mul(a, a));
+
+   const std::array<bn256::gfp, 5> edge = {
+      bn256::gfp{ 0, 0, 0, 0 },
+      bn256::gfp{ 1, 0, 0, 0 },
+      bn256::gfp{ 0x3c208c16d87cfd46, 0x97816a916871ca8d, 0xb85045b68181585d, 0x30644e72e131a029 }, // p-1
+      bn256::gfp{ 0x3c208c16d87cfd47, 0x97816a916871ca8d, 0xb85045b68181585d, 0x30644e72e131a029 }, // p
+      bn256::gfp{ 0xffffffffffffffff, 0xffffffffffffffff, 0xffffffffffffffff, 0xffffffffffffffff },
+   };
+   for (const auto& a : edge)
+      CHECK(bn256::gfp_sqr(a) == bn256::gfp_mul_generic(a, a));
+
+   for (int i = 0; i < 1000; ++i) {
+      bn256::gfp a{ bn256::random_255() };
+      CHECK(bn256::gfp_sqr(a) == bn256::gfp_mul_generic(a, a));
+      CHECK(a.square() == a.mul(a));
+   }
+}
+
+// Tests the safegcd inversion against Fermat's little theorem, a^(p-2).
+TEST_CASE("test_gfp_invert", "[gfp]"){
+   auto fermat = [](const bn256::gfp& a) {
+      constexpr std::array<uint64_t, 4> p_minus_2 = { 0x3c208c16d87cfd45, 0x97816a916871ca8d, 0xb85045b68181585d,
+                                                      0x30644e72e131a029 };
+      bn256::gfp sum = bn256::new_gfp(1), power = a;
+      for (auto word : p_minus_2) {
+         for (int bit = 0; bit < 64; bit++, word >>= 1) {
+            if (word & 1) sum = sum.mul(power);
+            power = power.square();
+         }
+      }
+      return sum;
+   };
+
+   // 1/2 is (p+1)/2.
+   constexpr std::array<uint64_t, 4> half = { 0x9e10460b6c3e7ea4, 0xcbc0b548b438e546, 0xdc2822db40c0ac2e, 0x183227397098d014 };
+   static_assert( bn256::gfp_invert({ 2, 0, 0, 0 }) == half ); // inversion mismatch
+
+   CHECK(bn256::gfp{}.invert() == bn256::gfp{});
+   CHECK(bn256::new_gfp(1).invert() == bn256::new_gfp(1));
+   CHECK(bn256::new_gfp(-1).invert() == bn256::new_gfp(-1));
+
+   const std::array<uint64_t, 4> pm1 = { 0x3c208c16d87cfd46, 0x97816a916871ca8d, 0xb85045b68181585d, 0x30644e72e131a029 };
+   CHECK(bn256::gfp_invert(pm1) == pm1);
+   CHECK(bn256::gfp_invert({ 1, 0, 0, 0 }) == std::array<uint64_t, 4>{ 1, 0, 0, 0 });
+
+   for (int i = 0; i < 1000; ++i) {
+      bn256::gfp a = bn256::gfp{ bn256::random_255() }.mont_decode();
+      CHECK(a.invert() == fermat(a));
+      CHECK(a.invert().mul(a) == bn256::new_gfp(1));
+   }
+}
+
+// Tests that batch inversion agrees with inverting one element at a time,
+// including zero elements.
+TEST_CASE("test_batch_invert", "[gfp]"){
+   std::vector<bn256::gfp> empty;
+   bn256::batch_invert(empty);
+
+   for (std::size_t n : { 1, 2, 3, 17 }) {
+      std::vector<bn256::gfp>  a(n), scratch(n);
+      std::vector<bn256::gfp2> b(n);
+      for (std::size_t i = 0; i < n; ++i) {
+         a[i] = bn256::gfp{ bn256::random_255() }.mont_decode();
+         b[i] = { bn256::gfp{ bn256::random_255() }.mont_decode(), bn256::gfp{ bn256::random_255() }.mont_decode() };
+      }
+      if (n > 2) {
+         a[0] = a[n / 2] = bn256::gfp{};
+         b[n - 1].set_zero();
+      }
+
+      auto inv_a = a;
+      auto inv_b = b;
+      bn256::batch_invert(inv_a, scratch);
+      bn256::batch_invert(inv_b);
+      for (std::size_t i = 0; i < n; ++i) {
+         CHECK(inv_a[i] == a[i].invert());
+         CHECK(inv_b[i] == b[i].invert());
+      }
+   }
+}
+
+// Tests square roots and quadratic characters in GF(p) and GF(p²).
+TEST_CASE("test_sqrt", "[gfp]"){
+   CHECK(bn256::gfp{}.sqrt() == bn256::gfp{});
+   CHECK(bn256::gfp{}.legendre() == 0);
+   CHECK(bn256::new_gfp(4).sqrt().square() == bn256::new_gfp(4));
+   CHECK(bn256::new_gfp(-1).legendre() == -1);
+   CHECK(bn256::gfp2::zero().sqrt() == bn256::gfp2::zero());
+   CHECK(bn256::gfp2{ {}, bn256::new_gfp(-1) }.sqrt().square() == bn256::gfp2{ {}, bn256::new_gfp(-1) });
+   CHECK(bn256::gfp2{ {}, bn256::new_gfp(-1) }.legendre() == 1);
+
+   for (int i = 0; i < 100; ++i) {
+      bn256::gfp a = bn256::gfp{ bn256::random_255() }.mont_decode();
+      bn256::gfp s = a.square();
+      CHECK(s.legendre() == 1);
+      CHECK(s.sqrt().square() == s);
+      CHECK(s.neg().legendre() == -1);
+      CHECK(s.neg().sqrt().square() != s.neg());
+      CHECK(a.sgn0() != a.neg().sgn0());
+
+      bn256::gfp2 b  = { bn256::gfp{ bn256::random_255() }.mont_decode(), bn256::gfp{ bn256::random_255() }.mont_decode() };
+      bn256::gfp2 b2 = b.square();
+      CHECK(b2.legendre() == 1);
+      CHECK(b2.sqrt().square() == b2);
+      CHECK(b.sgn0() != b.neg().sgn0());
+
+      // ξ = i+9 is not a square, so neither is ξb².
+      bn256::gfp2 n = b2.mul_xi();
+      CHECK(n.legendre() == -1);
+      CHECK(n.sqrt().square() != n);
+   }
+}
+
+// Tests that sums and differences of unreduced products reduce to the same
+// element as the corresponding reduced arithmetic.
+TEST_CASE("test_gfp_unreduced", "[gfp]"){
+   const bn256::gfp pm1 = { 0x3c208c16d87cfd46, 0x97816a916871ca8d, 0xb85045b68181585d, 0x30644e72e131a029 };
+   std::array<uint64_t, 8> wide{};
+   bn256::full_mul_u256(pm1.data(), pm1.data(), wide.data());
+   CHECK(bn256::gfp_mul_wide(pm1, pm1) == wide);
+
+   auto sum = pm1.mul_unreduced(pm1);
+   auto sum_reduced = pm1.mul(pm1);
+   for (int i = 0; i < 4; ++i) {
+      sum = sum.add_unreduced(pm1.mul_unreduced(pm1));
+      sum_reduced = sum_reduced.add(pm1.mul(pm1));
+   }
+   CHECK(sum.montgomery_reduce() == sum_reduced);
+
+   for (int i = 0; i < 1000; ++i) {
+      // mont_decode brings the random values below p.
+      bn256::gfp a = bn256::gfp{ bn256::random_255() }.mont_decode(), b = bn256::gfp{ bn256::random_255() }.mont_decode();
+      bn256::gfp c = bn256::gfp{ bn256::random_255() }.mont_decode(), d = bn256::gfp{ bn256::random_255() }.mont_decode();
+      bn256::full_mul_u256(a.data(), b.data(), wide.data());
+      CHECK(bn256::gfp_mul_wide(a, b) == wide);
+
+      auto ab = a.mul_unreduced(b), cd = c.mul_unreduced(d);
+      CHECK(ab.montgomery_reduce() == a.mul(b));
+      CHECK(ab.add_unreduced(cd).montgomery_reduce() == a.mul(b).add(c.mul(d)));
+      CHECK(ab.add(cd).add(cd).add(cd).montgomery_reduce() == a.mul(b).add(c.mul(d)).add(c.mul(d)).add(c.mul(d)));
+      CHECK(ab.sub(cd).montgomery_reduce() == a.mul(b).sub(c.mul(d)));
+      CHECK(cd.sub(ab).sub(ab).montgomery_reduce() == c.mul(d).sub(a.mul(b)).sub(a.mul(b)));
+   }
+}
+
+#ifdef BN256_REDUNDANT
+// Tests that operations accept both representatives of an element in [0, 2p),
+// keep their results in that range and agree modulo p.
+TEST_CASE("test_gfp_redundant", "[gfp]"){
+   const bn256::gfp two_p = { bn256::constants::two_p };
+   auto in_range = [&](const bn256::gfp& a) {
+      std::array<uint64_t, 4> t{};
+      return bn256::subborrow_u256(false, a.data(), two_p.data(), t.data());
+   };
+   auto lift = [](const bn256::gfp& a) {
+      bn256::gfp b{};
+      bn256::addcarry_u256(false, a.data(), bn256::constants::p2.data(), b.data());
+      return b;
+   };
+
+   for (int i = 0; i < 1000; ++i) {
+      bn256::gfp a = bn256::gfp{ bn256::random_255() }.mont_decode(), b = bn256::gfp{ bn256::random_255() }.mont_decode();
+      bn256::gfp la = lift(a), lb = lift(b);
+      CHECK(la == a);
+      CHECK(la.canonical() == static_cast<const std::array<uint64_t, 4>&>(a));
+
+      for (const auto& x : { a, la }) {
+         for (const auto& y : { b, lb }) {
+            CHECK(in_range(x.add(y)));
+            CHECK(in_range(x.sub(y)));
+            CHECK(in_range(x.mul(y)));
+            CHECK(x.add(y) == a.add(b));
+            CHECK(x.sub(y) == a.sub(b));
+            CHECK(x.mul(y) == a.mul(b));
+         }
+         CHECK(in_range(x.neg()));
+         CHECK(in_range(x.square()));
+         CHECK(x.neg() == a.neg());
+         CHECK(x.square() == a.square());
+      }
+   }
+   CHECK(lift(bn256::gfp::zero()) == bn256::gfp::zero());
+   CHECK(lift(bn256::gfp::zero()).neg() == bn256::gfp::zero());
+}
+#endif
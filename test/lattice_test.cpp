@@ -27,3 +27,44 @@ TEST_CASE("test lattice reduce target", "[lattice]"){
         CHECK(!is_neg(ks[i])); // reduction must be positive
     }
 }
+
+TEST_CASE("test lattice wnaf target", "[lattice]"){
+    constexpr int w = 5;
+    auto k = bn256::random_255();
+    auto ks = bn256::target_lattice.decompose(k);
+
+    for (std::size_t i = 0; i < 4; i++) {
+        std::array<int8_t, 512> digits{};
+        int len = bn256::wnaf<w>(ks[i], digits);
+        CHECK(len <= bitlen(ks[i]) + 1);
+
+        bn256::int512_t sum{};
+        for (int j = len - 1; j >= 0; --j) {
+            sum = (sum << 1) + bn256::int512_t{ digits[j] };
+            if (digits[j] != 0) {
+                CHECK(digits[j] % 2 != 0); // digits must be odd
+                CHECK(digits[j] < (1 << (w - 1)));
+                CHECK(digits[j] > -(1 << (w - 1)));
+                for (int l = j + 1; l < std::min(len, j + w); ++l)
+                    CHECK(digits[l] == 0); // non-adjacent
+            }
+        }
+        CHECK(sum == ks[i]);
+    }
+}
+
+template <std::size_t N>
+void check_rounding(const bn256::lattice<N>& l) {
+    for (std::size_t i = 0; i < N; i++) {
+        bn256::int512_t num = abs(l.inverse_[i]) << l.rounding_shift;
+        bn256::int512_t q = num / l.det_;
+        if (((num - q * l.det_) << 1) >= l.det_)
+            q += bn256::int512_t{ 1 };
+        CHECK((is_neg(l.inverse_[i]) ? -q : q) == l.rounding_[i]);
+    }
+}
+
+TEST_CASE("test lattice rounding constants", "[lattice]"){
+    check_rounding(bn256::curve_lattice);
+    check_rounding(bn256::target_lattice);
+}